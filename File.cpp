@@ -1,70 +1,300 @@
 #include "stdafx.h"
 #include "File.h"
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include "Windows.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
 #define CAPACITY 1024 * 1024
+#define NUM_BUFFERS 4 // So the memory used is fixed at NUM_BUFFERS * (CAPACITY + MAX_CONTIGUOUS)
+#define WRITE_CAPACITY 4 * 1024 * 1024
 
-File::File(const string& name) {
-  _handle = (s64)CreateFileA(name.c_str(), FILE_GENERIC_READ, NULL, nullptr, OPEN_EXISTING, NULL, nullptr);
-  if (_handle > 0) {
-    _buffer = new Vector<u8>(CAPACITY);
-    _buffer->Resize(CAPACITY); // It's a buffer, we won't ever actually fill it out.
-    Read();
+// The buffers form a ring: The consumer holds one of them, the background thread fills the free ones,
+// and the filled ones wait in between. Each buffer has MAX_CONTIGUOUS bytes of space in front of it,
+// so that the unread end of the previous buffer can be copied there (see Refill).
+struct File::ReadAhead {
+  vector<u8> buffers[NUM_BUFFERS];
+  int sizes[NUM_BUFFERS] = {};
+  int readIndex = 0;  // The next filled buffer for the consumer
+  int numFilled = 0;  // Filled buffers which the consumer hasn't taken yet
+  bool endOfFile = false;
+  bool stop = false;
+  mutex lock;
+  condition_variable filled;
+  condition_variable emptied;
+  thread reader;
+};
+
+File::File(const string& name, bool mapped) {
+#ifdef _WIN32
+  (void)mapped; // Only the read-ahead is implemented on Windows.
+  HANDLE handle = CreateFileA(name.c_str(), FILE_GENERIC_READ, NULL, nullptr, OPEN_EXISTING, NULL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) return;
+  _handle = (s64)handle;
+  LARGE_INTEGER fileSize;
+  if (GetFileSizeEx(handle, &fileSize)) _fileSize = fileSize.QuadPart;
+#else
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  struct stat info;
+  if (fstat(fd, &info) == 0) _fileSize = info.st_size;
+  if (mapped) {
+    void* data = _fileSize > 0 ? mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    if (data != MAP_FAILED) {
+      if (data) {
+        madvise(data, info.st_size, MADV_SEQUENTIAL);
+        _mapping = data;
+        _mappingSize = info.st_size;
+        _data = (const u8*)data;
+        _size = info.st_size;
+      }
+      close(fd); // The mapping keeps its own reference to the file.
+      return;
+    }
+    // The file can't be mapped (e.g. not enough address space), so fall back to the read-ahead.
+    cerr << "Could not map " << name << ", reading it instead" << endl;
   }
+  _handle = fd;
+#endif
 
-  // If I ever want it, here's how to compute the filesize in bytes:
-  // u64 fileSize;
-  // u32 lowSize = GetFileSize(badFile, (DWORD*)&fileSize + 1);
-  // *(u32*)&fileSize = lowSize;
+  _readAhead = new ReadAhead();
+  for (auto& buffer : _readAhead->buffers) buffer.resize(MAX_CONTIGUOUS + CAPACITY);
+  _readAhead->reader = thread([this] { ReadAheadLoop(); });
 }
 
 File::~File() {
-  if (_handle > 0) CloseHandle((HANDLE)_handle);
-  if (_buffer) delete _buffer;
+  if (_readAhead) {
+    {
+      lock_guard<mutex> guard(_readAhead->lock);
+      _readAhead->stop = true;
+    }
+    _readAhead->emptied.notify_one();
+    _readAhead->reader.join();
+    delete _readAhead;
+  }
+#ifdef _WIN32
+  if (_handle != -1) CloseHandle((HANDLE)_handle);
+#else
+  if (_handle != -1) close((int)_handle);
+  if (_mapping) munmap(_mapping, _mappingSize);
+#endif
 }
 
-u8 File::Get() {
-  u8 value = _buffer->At(_position);
-  _position++;
-  if (_position == _buffer->Size()) Read();
-  return value;
+int File::ReadAt(u64 offset, void* dest, int size) {
+  if (offset >= _fileSize) return 0;
+  if ((u64)size > _fileSize - offset) size = (int)(_fileSize - offset);
+  if (_mapping) {
+    memcpy(dest, (const u8*)_mapping + offset, size);
+    return size;
+  }
+  if (_handle == -1) return 0;
+  return ReadFromFile(offset, (u8*)dest, size);
 }
 
-u32 File::GetInt() {
-  u8 b1 = Get();
-  u8 b2 = Get();
-  u8 b3 = Get();
-  u8 b4 = Get();
+int File::ReadFromFile(u64 offset, u8* dest, int size) {
+#ifdef _WIN32
+  OVERLAPPED position = {};
+  position.Offset = (DWORD)offset;
+  position.OffsetHigh = (DWORD)(offset >> 32);
+  DWORD bytesRead = 0;
+  if (!ReadFile((HANDLE)_handle, dest, size, &bytesRead, &position)) return 0;
+  return (int)bytesRead;
+#else
+  int total = 0;
+  while (total < size) { // pread() may return less than we asked for, even before the end of the file.
+    ssize_t bytesRead = pread((int)_handle, dest + total, size - total, offset + total);
+    if (bytesRead <= 0) break;
+    total += (int)bytesRead;
+  }
+  return total;
+#endif
+}
+
+void File::ReadAheadLoop() {
+  ReadAhead& state = *_readAhead;
+  int writeIndex = 0;
+  u64 offset = 0;
+  while (true) {
+    {
+      // One buffer always belongs to the consumer, so we can fill at most NUM_BUFFERS - 1.
+      unique_lock<mutex> guard(state.lock);
+      state.emptied.wait(guard, [&] { return state.stop || state.numFilled < NUM_BUFFERS - 1; });
+      if (state.stop) return;
+    }
 
-  // Little-Endian.
-  return (b4 << 24) | (b3 << 16) | (b2 << 8) | b1;
+    int bytesRead = ReadFromFile(offset, &state.buffers[writeIndex][MAX_CONTIGUOUS], CAPACITY);
+    offset += bytesRead;
+    {
+      lock_guard<mutex> guard(state.lock);
+      if (bytesRead == 0) {
+        state.endOfFile = true;
+      } else {
+        state.sizes[writeIndex] = bytesRead;
+        state.numFilled++;
+      }
+    }
+    state.filled.notify_one();
+    if (bytesRead == 0) return;
+    writeIndex = (writeIndex + 1) % NUM_BUFFERS;
+  }
 }
 
-u8 File::Peek(u8 index) {
-  if (_position + index > _buffer->Size()) Fetch();
-  return _buffer->At(_position + index);
+void File::Refill(int count) {
+  if (_readAhead == nullptr) return; // Mapped (or missing) files are already entirely in _data.
+  ReadAhead& state = *_readAhead;
+
+  while (_size - _position < (u64)count) {
+    {
+      unique_lock<mutex> guard(state.lock);
+      state.filled.wait(guard, [&] { return state.numFilled > 0 || state.endOfFile; });
+      if (state.numFilled == 0) return; // End of file, there's nothing left to read.
+    }
+
+    // The background thread won't touch this buffer (it's filled) or our current one (until we release it below),
+    // so we can copy without holding the lock.
+    int remaining = (int)(_size - _position);
+    assert(remaining <= MAX_CONTIGUOUS);
+    u8* next = &state.buffers[state.readIndex][MAX_CONTIGUOUS];
+    if (remaining > 0) memmove(next - remaining, _data + _position, remaining);
+    _dataOffset += _position;
+    _data = next - remaining;
+    _size = remaining + state.sizes[state.readIndex];
+    _position = 0;
+
+    {
+      lock_guard<mutex> guard(state.lock);
+      state.readIndex = (state.readIndex + 1) % NUM_BUFFERS;
+      state.numFilled--;
+    }
+    state.emptied.notify_one();
+  }
 }
 
-bool File::Done() {
-  return _buffer == nullptr || _buffer->Empty();
+FileWriter::FileWriter(const string& name, s64 resumeAt) {
+  _buffer = new u8[WRITE_CAPACITY];
+#ifdef _WIN32
+  HANDLE handle = CreateFileA(name.c_str(), FILE_GENERIC_WRITE, NULL, nullptr, resumeAt == -1 ? CREATE_ALWAYS : OPEN_ALWAYS, NULL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    _failed = true;
+    return;
+  }
+  _handle = (s64)handle;
+  if (resumeAt != -1) {
+    LARGE_INTEGER position, fileSize;
+    position.QuadPart = resumeAt;
+    // Resuming only ever cuts the file off. If it is shorter than |resumeAt| then it doesn't match the checkpoint.
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart < resumeAt) _failed = true;
+    else if (!SetFilePointerEx(handle, position, nullptr, FILE_BEGIN) || !SetEndOfFile(handle)) _failed = true;
+    _offset = resumeAt;
+  }
+#else
+  int fd = open(name.c_str(), O_WRONLY | O_CREAT | (resumeAt == -1 ? O_TRUNC : 0), 0644);
+  if (fd < 0) {
+    _failed = true;
+    return;
+  }
+  _handle = fd;
+  if (resumeAt != -1) {
+    // Resuming only ever cuts the file off. If it is shorter than |resumeAt| then it doesn't match the checkpoint.
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < resumeAt) _failed = true;
+    else if (ftruncate(fd, resumeAt) != 0 || lseek(fd, resumeAt, SEEK_SET) != resumeAt) _failed = true;
+    _offset = resumeAt;
+  }
+#endif
+}
+
+FileWriter::~FileWriter() {
+  Flush();
+#ifdef _WIN32
+  if (_handle != -1) CloseHandle((HANDLE)_handle);
+#else
+  if (_handle != -1) close((int)_handle);
+#endif
+  delete[] _buffer;
+}
+
+void FileWriter::Write(const void* data, int size) {
+  if (_failed) return;
+  if (_size + size <= WRITE_CAPACITY) {
+    memcpy(_buffer + _size, data, size);
+    _size += size;
+    return;
+  }
+
+  // Write out the buffer and |data| together, rather than copying |data| through the buffer.
+  WriteToFile(_buffer, _size, (const u8*)data, size);
+  _size = 0;
+}
+
+void FileWriter::Flush() {
+  if (_size == 0) return;
+  WriteToFile(_buffer, _size, nullptr, 0);
+  _size = 0;
 }
 
-void File::Read() {
-  DWORD bytesRead;
-  ReadFile((HANDLE)_handle, &_buffer->At(0), CAPACITY, &bytesRead, nullptr);
-  _buffer->Resize(bytesRead);
-  _position = 0;
+bool FileWriter::Sync() {
+  Flush();
+  if (_failed) return false;
+#ifdef _WIN32
+  if (!FlushFileBuffers((HANDLE)_handle)) _failed = true;
+#else
+  if (fsync((int)_handle) != 0) _failed = true;
+#endif
+  return !_failed;
 }
 
-void File::Fetch() {
-  DWORD bytesRead;
-  int currentSize = _buffer->Size();
-  _buffer->Expand(CAPACITY);
-  _buffer->Resize(currentSize + CAPACITY);
-  ReadFile((HANDLE)_handle, &_buffer->At(currentSize), CAPACITY, &bytesRead, nullptr);
-  _buffer->Resize(currentSize + bytesRead);
+void FileWriter::WriteToFile(const u8* first, int firstSize, const u8* second, int secondSize) {
+  if (_failed) return;
+#ifdef _WIN32
+  for (auto [data, size] : {make_pair(first, firstSize), make_pair(second, secondSize)}) {
+    while (size > 0) { // WriteFile may write less than we asked for, so keep going until everything is written.
+      DWORD bytesWritten = 0;
+      if (!WriteFile((HANDLE)_handle, data, size, &bytesWritten, nullptr) || bytesWritten == 0) {
+        _failed = true;
+        return;
+      }
+      data += bytesWritten;
+      size -= bytesWritten;
+      _offset += bytesWritten;
+    }
+  }
+#else
+  iovec parts[2] = {{(void*)first, (size_t)firstSize}, {(void*)second, (size_t)secondSize}};
+  iovec* part = parts;
+  int numParts = secondSize > 0 ? 2 : 1;
+  while (numParts > 0) { // writev may write less than we asked for, so keep going until everything is written.
+    ssize_t written = writev((int)_handle, part, numParts);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) {
+      _failed = true;
+      return;
+    }
+    _offset += written;
+    while (numParts > 0 && (size_t)written >= part->iov_len) {
+      written -= part->iov_len;
+      part++;
+      numParts--;
+    }
+    if (numParts > 0) {
+      part->iov_base = (u8*)part->iov_base + written;
+      part->iov_len -= written;
+    }
+  }
+#endif
 }
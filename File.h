@@ -1,10 +1,16 @@
 #pragma once
 #include "forward.h"
+#include <cstring>
 #include <string>
 
+// Reader for the thread_N_{good,bad}.dat files. Reads are mostly sequential, but see ReadAt. There are two ways to read the file:
+// - Mapped (the default, except on Windows): The whole file is mapped into memory, so reading is just a load
+//   from the mapping, and the OS handles read-ahead (see MADV_SEQUENTIAL).
+// - Read-ahead: A background thread reads the file into a fixed ring of buffers, staying a few buffers ahead of us.
+//   Use this when page faults are slow (e.g. network drives), or when the file is too cold for the OS to keep up.
 class File {
 public:
-  File(const std::string& name);
+  File(const std::string& name, bool mapped = true);
   ~File();
   DELETE_RO3(File);
 
@@ -12,14 +18,108 @@ public:
   u32 GetInt();
   u8 Peek(u8 index = 0);
   bool Done();
+  // Returns a pointer to the next |count| bytes, and skips past them. The pointer is only valid until the next call.
+  // |count| must be at most MAX_CONTIGUOUS.
+  const u8* GetBytes(int count);
+
+  // The size of the file, in bytes (0 if it does not exist).
+  u64 Size() const { return _fileSize; }
+  // How far the sequential reads (Get, GetInt, etc) have got, in bytes from the start of the file.
+  u64 Offset() const { return _dataOffset + _position; }
+  // Copies |size| bytes starting at |offset| into |dest|, independently of (and without disturbing) the sequential reads.
+  // Safe to call from several threads at once. Returns the number of bytes copied, which is less than |size| at the end of the file.
+  int ReadAt(u64 offset, void* dest, int size);
+
+  static constexpr int MAX_CONTIGUOUS = 4096;
 
 private:
-  // Reads the next CAPACITY bytes into the buffer.
-  void Read();
-  // Expands the buffer, then reads the next CAPACITY bytes.
-  void Fetch();
-
-  s64 _handle = 0;
-  Vector<u8>* _buffer = nullptr;
-  int _position = 0;
+  struct ReadAhead;
+  // Called when there are fewer than |count| bytes left in _data. Moves on to the next buffer (with the remaining bytes
+  // copied in front of it), waiting for the background thread if needed. Does nothing if the file is mapped.
+  void Refill(int count);
+  // The background thread. Reads the file into the buffers, until it reaches the end of the file.
+  void ReadAheadLoop();
+  // Reads up to |size| bytes at |offset| into |dest|. Returns the number of bytes read, or 0 at the end of the file (or on error).
+  // This does not use (or move) the file pointer, so the background thread and ReadAt can both use it at once.
+  int ReadFromFile(u64 offset, u8* dest, int size);
+
+  const u8* _data = nullptr; // Either the whole file (if mapped), or the current buffer.
+  u64 _size = 0;             // Number of bytes in _data
+  u64 _position = 0;
+  u64 _dataOffset = 0;       // Where _data starts, in the file
+  u64 _fileSize = 0;
+  s64 _handle = -1;
+  void* _mapping = nullptr;
+  u64 _mappingSize = 0;
+  ReadAhead* _readAhead = nullptr;
+};
+
+inline u8 File::Get() {
+  if (_position >= _size) Refill(1);
+  assert(_position < _size);
+  return _data[_position++];
+}
+
+inline u32 File::GetInt() {
+  if (_position + sizeof(u32) > _size) Refill(sizeof(u32));
+  assert(_position + sizeof(u32) <= _size);
+  u32 value; // Little-Endian, same as the machine which wrote the file. memcpy since the data may not be aligned.
+  memcpy(&value, _data + _position, sizeof(value));
+  _position += sizeof(value);
+  return value;
+}
+
+inline u8 File::Peek(u8 index) {
+  if (_position + index >= _size) Refill(index + 1);
+  assert(_position + index < _size);
+  return _data[_position + index];
+}
+
+inline bool File::Done() {
+  if (_position < _size) return false;
+  Refill(1);
+  return _position >= _size;
+}
+
+inline const u8* File::GetBytes(int count) {
+  assert(count <= MAX_CONTIGUOUS);
+  if (_position + count > _size) Refill(count);
+  assert(_position + count <= _size);
+  const u8* data = _data + _position;
+  _position += count;
+  return data;
+}
+
+// Buffered writer for the thread_N_{good,bad}.dat files. Writes are collected in a large buffer, which is written
+// to the file once it fills up (or when the writer is destroyed), so each seed costs a memcpy instead of a syscall.
+// If |resumeAt| is not -1, the existing file is kept (truncated to |resumeAt| bytes) and written after, instead of replaced.
+// If the file is shorter than |resumeAt|, it doesn't match the checkpoint. It is not truncated, and the writer is Failed().
+class FileWriter {
+public:
+  FileWriter(const std::string& name, s64 resumeAt = -1);
+  ~FileWriter();
+  DELETE_RO3(FileWriter);
+
+  void Write(const void* data, int size);
+  void WriteInt(u32 value) { Write(&value, sizeof(value)); }
+  // Writes out the buffer.
+  void Flush();
+  // Writes out the buffer, and waits for the OS to put it on disk (fsync). Afterwards, the file is Offset() bytes.
+  // Returns false if anything could not be written (see Failed), in which case the file is not safe to checkpoint.
+  bool Sync();
+  // The size of the file, including anything still in the buffer.
+  u64 Offset() const { return _offset + _size; }
+  // True once opening, resuming, writing or syncing the file has failed (e.g. the disk is full). Failures are sticky:
+  // everything written afterwards is dropped, and Offset() stops at the bytes which were really written.
+  bool Failed() const { return _failed; }
+
+private:
+  // Writes |first| and then |second| to the file in one call (writev, on POSIX).
+  void WriteToFile(const u8* first, int firstSize, const u8* second, int secondSize);
+
+  u8* _buffer = nullptr;
+  int _size = 0;
+  u64 _offset = 0; // Bytes written to the file (not counting the buffer)
+  s64 _handle = -1;
+  bool _failed = false;
 };
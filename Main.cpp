@@ -1,5 +1,8 @@
 #include "stdafx.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <numeric>
@@ -11,12 +14,31 @@
 #define WIN32_LEAN_AND_MEAN
 #include "Windows.h"
 #include "File.h"
+#include "RingBuffer.h"
+#include "SolutionFile.h"
+#include "Trace.h"
+#include <fstream>
 #include <mutex>
+#include <new>
 
 using namespace std;
 
 Console console;
 
+#if COUNT_ALLOCATIONS
+// Counts the allocations on each thread, for the bench mode (see StdLib.h). This is just an increment on top of malloc.
+thread_local u64 numAllocations = 0;
+
+void* operator new(size_t size) {
+  numAllocations++;
+  void* ptr = malloc(size);
+  if (ptr == nullptr) throw bad_alloc();
+  return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+#endif
+
 // Functions I wish std::string had
 bool Contains(const std::string_view& str, const std::string_view& substr) {
   if (substr.size() > str.size()) return false;
@@ -269,6 +291,554 @@ void GenerateTables(const unordered_map<u32, u32>& totalPuzzles, u64 uberTotal)
   GenerateTable(totalPuzzles, uberTotal, { 0x001F, 0x0117, 0x003E, 0x0136 }, { 0x0174, 0x003E, 0x0447, 0x0136, 0x0117, 0x0744, 0x0364, 0x007C, 0x0326, 0x00F1, 0x0463, 0x0471, 0x00F8, 0x0623, 0x001F, 0x008F, 0x00E3, 0x00C7, 0x0711, 0x0631 });
 }
 
+// The statistics which "good" reports: for each pair of polyominos (the polykey), which configurations (polyishes)
+// the puzzles can be solved with, and whether the stars can be inside or outside the polyomino region.
+struct PolyStatistics {
+  unordered_map<u32, unordered_map<u64, u32>> combinedPolyshapes;
+  unordered_map<u32, unordered_map<u64, u32>> uniquePolyshapes;
+  unordered_map<u32, u32> totalPuzzles;
+  unordered_map<u32, u32[4]> starStatistics;
+  u64 totalPolysTogether = 0;
+  u64 totalPolysApart = 0;
+  u64 totalPolysBoth = 0;
+
+  // Adds a solvable puzzle, with the partition (see PuzzleDescriptor::Partition) of each of its solutions.
+  void Add(const PuzzleDescriptor& descriptor, const vector<u64>& partitions) {
+    bool canContainStars = false;
+    bool canExcludeStars = false;
+    std::unordered_set<u64> validPolyshapes;
+
+    struct NormalizedPolys {
+      u16 poly1 = 0xFFFF;
+      u16 poly2 = 0xFFFF;
+      u8 rotation = 0;
+      bool flip = false;
+    } min;
+
+    u16 polyshape1 = descriptor.polyshapes[0];
+    u16 polyshape2 = descriptor.polyshapes[1];
+    bool flipped = false;
+    u8 rotation = 0;
+
+    for (u8 j=0; j<8; j++) {
+      if (j == 4) {
+        polyshape1 = Polyominos::Flip(polyshape1);
+        polyshape2 = Polyominos::Flip(polyshape2);
+        flipped = !flipped;
+        rotation -= 2;
+      } else {
+        polyshape1 = Polyominos::RotatePolyshape(polyshape1);
+        polyshape2 = Polyominos::RotatePolyshape(polyshape2);
+        rotation++;
+      }
+      polyshape1 = Polyominos::Normalize(polyshape1);
+      polyshape2 = Polyominos::Normalize(polyshape2);
+
+      for (int k=0; k<2; k++) {
+        if (__popcnt16(polyshape1) < __popcnt16(min.poly1)
+         || __popcnt16(polyshape1) == __popcnt16(min.poly1) && polyshape1 < min.poly1
+         || __popcnt16(polyshape1) == __popcnt16(min.poly1) && polyshape1 == min.poly1 && __popcnt16(polyshape2) < __popcnt16(min.poly2)
+         || __popcnt16(polyshape1) == __popcnt16(min.poly1) && polyshape1 == min.poly1 && __popcnt16(polyshape2) == __popcnt16(min.poly2) && polyshape2 < min.poly2) {
+          min.poly1 = polyshape1;
+          min.poly2 = polyshape2;
+          min.rotation = rotation;
+          min.flip = flipped;
+        }
+        swap(polyshape1, polyshape2); // To avoid writing the above logic twice
+      }
+    }
+    u32 polyKey = 0;
+    // If the left-hand poly (poly2) fills the right-most column, shift the right-hand poly one row.
+    // Due to the minimization, we will never have 4-wide polyominos -- only 4-tall.
+    if (min.poly2 & 0xF000) min.poly1 <<= 4;
+    polyKey = (min.poly1 << 16) | min.poly2;
+
+    for (u64 partition : partitions) {
+      u16 region = PuzzleDescriptor::RegionOf(partition, descriptor.polyCells[0]);
+      bool sameRegion = region & (1 << descriptor.polyCells[1]);
+      bool containsStars = region & descriptor.stars;
+
+      if (sameRegion) {
+        u64 polyish = Puzzle::GetPolyish(PuzzleDescriptor::ToPolyishCells(region), min.rotation, min.flip);
+        assert(__popcnt16(min.poly1) + __popcnt16(min.poly2) == __popcnt64(polyish));
+        validPolyshapes.insert(polyish);
+      } else {
+        validPolyshapes.insert(0);
+      }
+      if (containsStars) canContainStars = true;
+      else               canExcludeStars = true;
+    } // done with puzzle
+
+    for (u64 polyish : validPolyshapes) combinedPolyshapes[polyKey][polyish]++;
+    if (validPolyshapes.size() == 1) uniquePolyshapes[polyKey][*validPolyshapes.begin()]++;
+    totalPuzzles[polyKey]++;
+
+    u8 starsValue = (canContainStars ? 1 : 0) + (canExcludeStars ? 2 : 0);
+    starStatistics[polyKey][starsValue]++;
+
+    if (validPolyshapes.find(0) == validPolyshapes.end()) {
+      totalPolysTogether++; // No configuration allows the polys to be apart
+    } else {
+      if (validPolyshapes.size() == 1) {
+        totalPolysApart++; // There is only one configuration and it has the polys apart
+      } else {
+        totalPolysBoth++; // There are multiple configurations allowing apart & together
+      }
+    }
+  }
+
+  void Merge(const PolyStatistics& other) {
+    for (const auto& [polykey, counts] : other.combinedPolyshapes) {
+      for (const auto& [polyish, count] : counts) combinedPolyshapes[polykey][polyish] += count;
+    }
+    for (const auto& [polykey, counts] : other.uniquePolyshapes) {
+      for (const auto& [polyish, count] : counts) uniquePolyshapes[polykey][polyish] += count;
+    }
+    for (const auto& [polykey, total] : other.totalPuzzles) totalPuzzles[polykey] += total;
+    for (const auto& [polykey, counts] : other.starStatistics) {
+      for (int i=0; i<4; i++) starStatistics[polykey][i] += counts[i];
+    }
+    totalPolysTogether += other.totalPolysTogether;
+    totalPolysApart += other.totalPolysApart;
+    totalPolysBoth += other.totalPolysBoth;
+  }
+
+  // Prints the report (an HTML page) to cout.
+  void Print() {
+    // Start of file, etc.
+    cout << R"(<html>
+<head>
+  <style>
+    * {
+      font-family: Constantia;
+    }
+    pre, .polykey {
+      white-space: pre;
+      font-family: monospace;
+    }
+    td {
+      border: 1px solid black;
+      border-collapse: collapse;
+      padding: 2px;
+      text-align: center;
+      width: 50px;
+    }
+  </style>
+</head>
+<body>)";
+
+    u64 uberTotal = 0;
+    u64 uberUnique = 0;
+    // u64 totalStarsContained = 0;
+    // u64 totalStarsExcluded = 0;
+    // u64 totalStarsBoth = 0;
+
+    vector<pair<u32, u32>> sortedPolyshapes;
+    for (const auto& [polykey, total] : totalPuzzles) {
+      uberTotal += total;
+      for (const auto& [polyish, count] : uniquePolyshapes[polykey]) uberUnique += count;
+      sortedPolyshapes.emplace_back(polykey, total);
+    }
+    // Ties are broken by the key, so that the report doesn't depend on the order the puzzles were added in.
+    sort(sortedPolyshapes.begin(), sortedPolyshapes.end(), [](const pair<u32, u32>& a, const pair<u32, u32>& b) { return a.second > b.second || a.second == b.second && a.first < b.first; });
+
+    cout << "There are a total of " << uberTotal << " polyominos + stars puzzles<br>\n";
+    cout << uberUnique << " (" << (100.0f * uberUnique / uberTotal) << "%) of these puzzles can only be solved with one configuration<br>\n";
+    cout << totalPolysTogether << " puzzles (" << (100.0f * totalPolysTogether) / uberTotal << "% of all puzzles) must be solved with the polyominos combined<br>\n";
+    cout << totalPolysApart << " puzzles (" << (100.0f * totalPolysApart) / uberTotal << "% of all puzzles) must be solved with the polyominos separated<br>\n";
+    cout << totalPolysBoth << " puzzles (" << (100.0f * totalPolysBoth) / uberTotal << "% of all puzzles) can be solved either way<br>\n";
+    assert(uberTotal == totalPolysTogether + totalPolysApart + totalPolysBoth);
+    cout << "<br><span class='anchor' id='table-of-contents'><h2>Table of contents</h2></span>";
+    GenerateTables(totalPuzzles, uberTotal);
+    cout << fixed; // no scientific notation please
+
+    for (const auto& [polykey, total] : sortedPolyshapes) {
+      const auto& combinedData = combinedPolyshapes[polykey];
+      const auto& uniqueData = uniquePolyshapes[polykey];
+      u32 uniqueTotal = 0;
+      for (const auto& [key2, data2] : uniqueData) uniqueTotal += data2;
+
+      cout << "<span class='anchor' id='" << polykey << "'></span>";
+      cout << "---------------------------------------------------------------------------------------------------------------------------------------<br>\n";
+      cout << "<small><a href='#table-of-contents'>Jump to top</a></small><br>\n";
+      cout << "This pair of polyominos is present in " << total << " puzzles (" << (100.0f * total) / uberTotal << "% of all puzzles)<br>\n";
+      cout << "Of those puzzles, " << uniqueTotal << " (" << (100.0f * uniqueTotal / total) << "%) can only be solved with one configuration of polyominos<br>\n";
+      cout << "<pre>" << PrintPolykey(polykey) << "</pre>";
+
+      vector<pair<u64, u32>> items;
+      for (const auto& it : combinedData) items.push_back(it);
+      sort(items.begin(), items.end(), [](const pair<u64, u32>& a, const pair<u64, u32>& b) { return a.second > b.second || a.second == b.second && a.first < b.first; });
+
+      for (const auto& [polyish, count] : items) {
+        u32 uniqueCount = uniqueData.at(polyish);
+
+        if (polyish == 0) {
+          cout << count << " (" << (100.0f * count) / total << "%) of these puzzles can be solved with the polyominos separated<br>\n";
+          cout << uniqueCount << " (" << (100.0f * uniqueCount) / total << "%) of these puzzles must be solved with the polyominos separated<br>\n";
+        } else {
+          cout << count << " (" << (100.0f * count) / total << "%) of these puzzles can be solved with the polyominos in this configuration:<br>\n";
+          cout << uniqueCount << " (" << (100.0f * uniqueCount) / total << "%) of these puzzles must be solved with the polyominos in this configuration:<br>\n";
+          cout << "<pre>" << PrintPolyish(polyish, 8, 8, polykey) << "</pre>";
+        }
+      }
+    }
+
+    cout << "</body></html>";
+  }
+};
+
+// The contents of puzzle_solvability.dat: one bit per puzzle, which is cleared if the puzzle is unsolvable.
+// This is 256 MB, so the threads building it share one copy, rather than each having their own.
+class Solvability {
+public:
+  Solvability() : _bits(1 << 27) {
+    for (atomic<u16>& bits : _bits) bits.store(0xFFFF, memory_order_relaxed);
+  }
+
+  // Marks the puzzle generated from |seed| as unsolvable. Safe to call from several threads at once.
+  void MarkUnsolvable(Random& rng, u32 seed) {
+    rng.Set(seed);
+    // While generating data, we do not differentiate a generation failure from an unsolvable puzzle, as both incur a reroll.
+    // However, for the purposes of computing solvability, we only want to denote actualy unsolvable puzzles,
+    // ergo we  need to skip any puzzles which failed due to a stars failure.
+    int rerollCount = rng.CheckStarsFailure();
+    if (rerollCount > 2) return;
+
+    // We use a value based on the initial seed here, because the final seed is not actually unique!
+    // Two puzzles may share a final seed if they had different polyomino sizes, since differently-sized polyominos
+    // will increment the RNG a different number of times. Ergo, differentiating based on the end RNG is not possible.
+    // Instead, we use the initial seed. However, if a puzzle fails, we jump to just before the starts failure,
+    // which means *that* moment is the "initial" seed for re-rolls. To avoid extra normalization, we always use that location,
+    // which is 11 RNG steps beyond the initial seed, +2 for the stars roll.
+    for (int k=0; k<13; k++) rng.Get();
+    // if (rng.Peek() == 0x6a5d128c) DebugBreak();
+
+    // Computing *solvability* here
+    _bits[rng.Peek() >> 4].fetch_and((u16)~(1 << (rng.Peek() % 16)), memory_order_relaxed);
+  }
+
+  // Returns false if the file could not be written.
+  bool Save(const string& name) const {
+    static_assert(sizeof(atomic<u16>) == sizeof(u16));
+    FileWriter output(name);
+    output.Write(_bits.data(), (int)(_bits.size() * sizeof(u16)));
+    output.Flush();
+    return !output.Failed();
+  }
+
+private:
+  vector<atomic<u16>> _bits;
+};
+
+// The generators used by the benchmarking and analysis modes.
+// GenerateStonesPillar is left out, since it takes far too long per seed.
+const char* generatorNames[] = {"SimpleMaze", "HardMaze", "Stones", "Pedestal", "Polyominos", "Stars", "Symmetry", "Triangles6", "Triangles8", "DotsPillar"};
+const int numGenerators = sizeof(generatorNames) / sizeof(generatorNames[0]);
+
+Puzzle* Generate(Random& rng, int generator) {
+  switch (generator) {
+    case 0: return rng.GenerateSimpleMaze();
+    case 1: return rng.GenerateHardMaze();
+    case 2: return rng.GenerateStones();
+    case 3: return rng.GeneratePedestal();
+    case 4: return rng.GeneratePolyominos(false);
+    case 5: return rng.GenerateStars();
+    case 6: return rng.GenerateSymmetry();
+    case 7: return rng.GenerateTriangles(6);
+    case 8: return rng.GenerateTriangles(8);
+    case 9: return rng.GenerateDotsPillar();
+  }
+  assert(false);
+  return nullptr;
+}
+
+// Prints one row of SolverStats, averaged over |numSeeds|. See PrintStatsHeader for the columns.
+void PrintStats(const char* name, const SolverStats& stats, u64 numSeeds) {
+  double n = (double)max(numSeeds, 1ull);
+  cout << name << "\t" << stats.nodes / n << "\t" << stats.gapRejections / n << "\t" << stats.prunes / n;
+  cout << "\t" << stats.endpointValidations / n << "\t" << stats.regionsComputed / n;
+  cout << "\t" << stats.polyFits / n << "\t" << stats.placements / n << endl;
+}
+
+void PrintStatsHeader() {
+  cout << "generator\tnodes\tgaps\tprunes\tvalidations\tregions\tpolyfits\tplacements\t(per seed)" << endl;
+}
+
+// Tracks how long each seed took to generate and solve: The K slowest seeds (with their solver node counts),
+// and a histogram of every seed. Like HdrHistogram, each power of 2 is split into 2^SUB_BUCKET_BITS linear buckets,
+// so percentiles are accurate to about 3% at any scale, in a fixed amount of memory.
+struct LatencyTracker {
+  static constexpr int K = 32;
+  static constexpr int SUB_BUCKET_BITS = 5;
+  static constexpr u64 SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+
+  struct SlowSeed {
+    u64 nanos;
+    u64 nodes;
+    u32 seed;
+    bool operator>(const SlowSeed& other) const { return nanos > other.nanos; }
+  };
+  vector<SlowSeed> slowest; // A min-heap, so that the fastest of the slow seeds is at the front.
+  vector<u64> histogram = vector<u64>(64 * SUB_BUCKETS, 0);
+  u64 count = 0;
+
+  void Add(u32 seed, u64 nanos, u64 nodes) {
+    histogram[BucketOf(nanos)]++;
+    count++;
+    AddSlowSeed({nanos, nodes, seed});
+  }
+
+  void Merge(const LatencyTracker& other) {
+    for (size_t i=0; i<histogram.size(); i++) histogram[i] += other.histogram[i];
+    count += other.count;
+    for (const SlowSeed& slow : other.slowest) AddSlowSeed(slow);
+  }
+
+  void AddSlowSeed(const SlowSeed& slow) {
+    if (slowest.size() < K) {
+      slowest.push_back(slow);
+      push_heap(slowest.begin(), slowest.end(), greater<SlowSeed>());
+    } else if (slow.nanos > slowest.front().nanos) {
+      pop_heap(slowest.begin(), slowest.end(), greater<SlowSeed>());
+      slowest.back() = slow;
+      push_heap(slowest.begin(), slowest.end(), greater<SlowSeed>());
+    }
+  }
+
+  // Values below SUB_BUCKETS get their own bucket. Above that, the bucket is the top SUB_BUCKET_BITS+1 bits of the value
+  // (the first of which is always set), plus which power of 2 it's in.
+  static u32 BucketOf(u64 value) {
+    if (value < SUB_BUCKETS) return (u32)value;
+    u32 msb = SUB_BUCKET_BITS;
+    while (value >> (msb + 1)) msb++;
+    u32 shift = msb - SUB_BUCKET_BITS;
+    return (u32)(((shift + 1) << SUB_BUCKET_BITS) + ((value >> shift) - SUB_BUCKETS));
+  }
+
+  // The largest value which falls into |bucket|.
+  static u64 BucketMax(u32 bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    u32 shift = (bucket >> SUB_BUCKET_BITS) - 1;
+    u64 sub = bucket & (SUB_BUCKETS - 1);
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+  }
+
+  u64 Percentile(double percentile) const {
+    u64 target = (u64)ceil(count * percentile / 100.0);
+    u64 seen = 0;
+    for (u32 i=0; i<histogram.size(); i++) {
+      seen += histogram[i];
+      if (seen >= max(target, 1ull)) return BucketMax(i);
+    }
+    return 0;
+  }
+
+  void Print(const char* name) const {
+    auto ms = [](u64 nanos) { return nanos / 1'000'000.0; };
+    cout << name << ": " << count << " seeds, p50 " << ms(Percentile(50)) << "ms, p90 " << ms(Percentile(90));
+    cout << "ms, p99 " << ms(Percentile(99)) << "ms, p99.9 " << ms(Percentile(99.9)) << "ms, max " << ms(Percentile(100)) << "ms" << endl;
+
+    vector<SlowSeed> sorted = slowest;
+    sort(sorted.begin(), sorted.end(), greater<SlowSeed>());
+    cout << "seed\tms\tnodes" << endl;
+    for (const SlowSeed& slow : sorted) {
+      cout << "0x" << hex << uppercase << setfill('0') << setw(8) << slow.seed << dec << setfill(' ') << "\t" << ms(slow.nanos) << "\t" << slow.nodes << endl;
+    }
+  }
+};
+
+// The progress of a thrd run, saved every so often so that an interrupted run can be continued (see "thrd --resume").
+// Seeds are handed out in blocks (see SeedScheduler). Every block before nextBlock is finished, except for each thread's
+// pending blocks, which it took after its output files were last synced (at which point they were goodOffset and badOffset bytes).
+struct Checkpoint {
+  // The settings of the run, so that --resume doesn't need them repeated
+  u32 firstSeed = 0;
+  u32 lastSeed = 0;
+  u32 numThreads = 0;
+  u32 threadOffset = 0; // Thread i writes to thread_{i + threadOffset}_*, so that runs on several machines don't collide.
+
+  u32 nextBlock = 0;
+  struct Thread {
+    u64 goodOffset = 0; // 0 if the thread had not synced yet, in which case its files start over.
+    u64 badOffset = 0;
+    vector<u32> pendingBlocks;
+  };
+  vector<Thread> threads;
+
+  // Returns false (and leaves this unchanged) if there is no checkpoint.
+  bool Load(const string& name) {
+    // If we were stopped in the middle of Save (on Windows), the checkpoint may only be in the temporary file.
+    for (const string& fileName : {name, name + ".tmp"}) {
+      File file(fileName);
+      vector<u8> data(file.Size());
+      if (data.empty() || file.ReadAt(0, data.data(), (int)data.size()) != (int)data.size()) continue;
+      const u8* position = data.data();
+      const u8* end = position + data.size();
+      auto Read = [&](auto& value) {
+        if (end - position < (s64)sizeof(value)) return false;
+        memcpy(&value, position, sizeof(value));
+        position += sizeof(value);
+        return true;
+      };
+
+      Checkpoint checkpoint;
+      if (!Read(checkpoint.firstSeed) || !Read(checkpoint.lastSeed) || !Read(checkpoint.numThreads)
+        || !Read(checkpoint.threadOffset) || !Read(checkpoint.nextBlock)) continue;
+      if (checkpoint.numThreads > (u64)(end - position) / (sizeof(u64) + sizeof(u64) + sizeof(u32))) continue;
+      checkpoint.threads.resize(checkpoint.numThreads);
+      bool valid = true;
+      for (Thread& thread : checkpoint.threads) {
+        u32 numPending = 0;
+        valid = valid && Read(thread.goodOffset) && Read(thread.badOffset) && Read(numPending);
+        if (!valid || numPending > (u64)(end - position) / sizeof(u32)) break;
+        thread.pendingBlocks.resize(numPending);
+        for (u32& block : thread.pendingBlocks) Read(block);
+      }
+      if (!valid || position != end) continue;
+      *this = move(checkpoint);
+      return true;
+    }
+    return false;
+  }
+
+  // The output files must already be on disk. The checkpoint is written to a temporary file which then replaces the old
+  // checkpoint, so that being stopped part way through never leaves a partial checkpoint. Returns false (and leaves the
+  // old checkpoint alone) if the temporary file could not be written.
+  bool Save(const string& name) const {
+    {
+      FileWriter file(name + ".tmp");
+      file.WriteInt(firstSeed);
+      file.WriteInt(lastSeed);
+      file.WriteInt(numThreads);
+      file.WriteInt(threadOffset);
+      file.WriteInt(nextBlock);
+      for (const Thread& thread : threads) {
+        file.Write(&thread.goodOffset, sizeof(thread.goodOffset));
+        file.Write(&thread.badOffset, sizeof(thread.badOffset));
+        file.WriteInt((u32)thread.pendingBlocks.size());
+        for (u32 block : thread.pendingBlocks) file.WriteInt(block);
+      }
+      if (!file.Sync()) return false;
+    }
+    if (rename((name + ".tmp").c_str(), name.c_str()) != 0) { // Windows won't rename over an existing file.
+      remove(name.c_str());
+      if (rename((name + ".tmp").c_str(), name.c_str()) != 0) return false;
+    }
+    return true;
+  }
+};
+
+// Hands out the seeds for thrd in blocks: whenever a thread finishes a block it takes the next one, so a thread which
+// gets slow seeds just does fewer blocks, instead of holding up the whole run. Blocks are handed out in order, so each
+// thread's seeds (and therefore its files) are still in increasing order.
+// The cursor is behind a lock rather than atomic, since the checkpoint has to see a block taken and recorded together.
+// Threads only take the lock once per block, so it is never contended.
+class SeedScheduler {
+public:
+  // Continues from |checkpoint| (or starts the run, if it is new), and saves the progress to |name|.
+  SeedScheduler(const Checkpoint& checkpoint, const string& name) : _checkpoint(checkpoint), _name(name) {
+    _numBlocks = (checkpoint.lastSeed - checkpoint.firstSeed) / BLOCK_SIZE + 1;
+    _numTaken.resize(checkpoint.threads.size());
+  }
+
+  // Sets [firstSeed, lastSeed] to the next block for |thread|, or returns false once every block has been handed out.
+  // If we resumed, the blocks which |thread| had not finished come first.
+  bool NextBlock(int thread, u32& firstSeed, u32& lastSeed) {
+    std::lock_guard<std::mutex> guard(_lock);
+    vector<u32>& pending = _checkpoint.threads[thread].pendingBlocks;
+    if (_numTaken[thread] == pending.size()) {
+      if (_checkpoint.nextBlock == _numBlocks) return false;
+      pending.push_back(_checkpoint.nextBlock++);
+    }
+    u32 block = pending[_numTaken[thread]++];
+    firstSeed = _checkpoint.firstSeed + block * BLOCK_SIZE;
+    lastSeed = min(_checkpoint.lastSeed, firstSeed + (BLOCK_SIZE - 1));
+    return true;
+  }
+
+  // Called once |numFinished| more of |thread|'s blocks have been written, and its files are on disk (and goodOffset
+  // and badOffset bytes long). Blocks are finished in the order they were taken. Returns false if the checkpoint
+  // could not be saved.
+  bool SaveCheckpoint(int thread, size_t numFinished, u64 goodOffset, u64 badOffset) {
+    std::lock_guard<std::mutex> guard(_lock);
+    Checkpoint::Thread& state = _checkpoint.threads[thread];
+    assert(numFinished <= _numTaken[thread]);
+    state.pendingBlocks.erase(state.pendingBlocks.begin(), state.pendingBlocks.begin() + numFinished);
+    _numTaken[thread] -= numFinished;
+    state.goodOffset = goodOffset;
+    state.badOffset = badOffset;
+    return _checkpoint.Save(_name);
+  }
+
+  // Small enough that the threads finish at about the same time, but large enough that taking a block is rare.
+  static constexpr u32 BLOCK_SIZE = 0x1000;
+
+private:
+  std::mutex _lock;
+  Checkpoint _checkpoint;
+  string _name;
+  u32 _numBlocks;
+  vector<size_t> _numTaken; // Per thread, how many of its pending blocks it has been given
+};
+
+// One seed on its way from a thrd solver thread to its writer thread, or a marker between blocks.
+struct SolvedSeed {
+  enum class Kind : u8 {
+    Seed,       // A solved seed
+    EndOfBlock, // Every seed in the block has been sent
+    Finished,   // There are no more blocks
+  };
+  Kind kind = Kind::Seed;
+  u32 seed = 0;
+  u32 endingRng = 0;
+  Puzzle* puzzle = nullptr; // Owned by whichever thread holds this
+  Vector<Path> solutions;
+};
+
+// Calls |op| (in doubling batches, so that cheap ops aren't dominated by the clock) for at least |minTime|,
+// then prints the time (and allocations, if COUNT_ALLOCATIONS is set) per call as one line of JSON.
+template <typename Op>
+void Bench(const string& name, Op&& op, chrono::nanoseconds minTime = chrono::milliseconds(200)) {
+  u64 numOps = 0;
+#if COUNT_ALLOCATIONS
+  u64 startAllocations = numAllocations;
+#endif
+  auto start = chrono::steady_clock::now();
+  chrono::nanoseconds elapsed(0);
+  for (u64 batch = 1; elapsed < minTime; batch *= 2) {
+    for (u64 i=0; i<batch; i++) op();
+    numOps += batch;
+    elapsed = chrono::steady_clock::now() - start;
+  }
+  cout << "{\"name\": \"" << name << "\", \"ops\": " << numOps;
+  cout << ", \"ns_per_op\": " << fixed << setprecision(1) << (double)elapsed.count() / numOps;
+#if COUNT_ALLOCATIONS
+  cout << ", \"allocs_per_op\": " << setprecision(2) << (double)(numAllocations - startAllocations) / numOps;
+#endif
+  cout << "}" << endl;
+}
+
+// Draws |path| (in the format from Solver::Solve) onto |puzzle|, or erases it if |line| is None.
+// Symmetry puzzles are not supported, since this does not draw the reflection.
+void DrawPath(Puzzle* puzzle, const Path& path, Line line) {
+  s8 x = path[0];
+  s8 y = path[1];
+  puzzle->_startPoint = puzzle->GetCell(x, y);
+  for (int i=2;; i++) {
+    Cell* cell = puzzle->GetCell(x, y);
+    cell->line = line;
+    u8 dir = path[i];
+    if (dir == PATH_NONE) {
+      puzzle->_endPoint = cell;
+      break;
+    }
+    if (dir == PATH_LEFT)        x--;
+    else if (dir == PATH_RIGHT)  x++;
+    else if (dir == PATH_TOP)    y--;
+    else if (dir == PATH_BOTTOM) y++;
+  }
+}
+
 int main(int argc, char* argv[]) {
 #ifdef _DEBUG
   _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -307,6 +877,124 @@ int main(int argc, char* argv[]) {
       assert((numSolutions > 0) == Random::IsSolvable(rng.Peek()));
       delete p;
     }
+
+    // Round trip the tests3 solutions through each version of the solution file, with tiny chunks so that several
+    // chunk headers (and the index) are written. The v4 file is also stopped at a checkpoint and resumed halfway through.
+    vector<u32> seeds;
+    for (const auto& [initRng, endRng, numSolutions] : tests3) seeds.push_back(initRng);
+    sort(seeds.begin(), seeds.end());
+    vector<Vector<Path>> allSolutions;
+    vector<PuzzleDescriptor> descriptors;
+    vector<vector<u64>> allPartitions;
+    for (u32 seed : seeds) {
+      rng.Set(seed);
+      Puzzle* p = rng.GeneratePolyominos(false);
+      allSolutions.push_back(Solver().Solve(p));
+      descriptors.push_back(PuzzleDescriptor::Describe(p));
+      const PuzzleDescriptor& descriptor = descriptors.back();
+
+      int numPolys = 0, numGaps = 0;
+      for (u8 x=0; x<p->_width; x++) {
+        for (u8 y=0; y<p->_height; y++) {
+          Cell* cell = p->GetCell(x, y);
+          if (x % 2 != y % 2 && cell->gap != Gap::None) numGaps++;
+          if (x % 2 == 0 || y % 2 == 0) continue;
+          u8 index = (x / 2) * 4 + y / 2;
+          assert(((descriptor.stars >> index) & 1) == (cell->type == Type::Star));
+          if (cell->polyshape == 0) continue;
+          assert(descriptor.polyCells[numPolys] == index && descriptor.polyshapes[numPolys] == cell->polyshape);
+          numPolys++;
+        }
+      }
+      assert(numPolys == 2 && (int)__popcnt64(descriptor.gaps) == numGaps);
+
+      allPartitions.emplace_back();
+      for (const Path& solution : allSolutions.back()) {
+        u64 partition = PuzzleDescriptor::Partition(p, solution);
+        allPartitions.back().push_back(partition);
+
+        // Trace the solution, and compare each cell's region with the partition.
+        s8 x = solution[0];
+        s8 y = solution[1];
+        for (int i=2;; i++) {
+          p->GetCell(x, y)->line = Line::Black;
+          if (solution[i] == PATH_NONE) break;
+          else if (solution[i] == PATH_LEFT)   x--;
+          else if (solution[i] == PATH_RIGHT)  x++;
+          else if (solution[i] == PATH_TOP)    y--;
+          else if (solution[i] == PATH_BOTTOM) y++;
+        }
+        for (u8 index=0; index<16; index++) {
+          u16 cells = 0;
+          for (Cell* cell : p->GetRegion((index / 4) * 2 + 1, (index % 4) * 2 + 1)) {
+            if (cell->x % 2 == 1 && cell->y % 2 == 1) cells |= 1 << ((cell->x / 2) * 4 + cell->y / 2);
+          }
+          assert(cells == PuzzleDescriptor::RegionOf(partition, index));
+        }
+        p->ClearGrid(true);
+      }
+      delete p;
+    }
+
+    const string name = "test_solutions.dat";
+    const size_t half = seeds.size() / 2;
+    for (u8 version=2; version<=SolutionReader::VERSION; version++) {
+      if (version < SolutionReader::VERSION) {
+        SolutionWriter writer(name, 0, 8, -1, 3, version);
+        for (size_t i=0; i<seeds.size(); i++) writer.Write(seeds[i], allSolutions[i], descriptors[i], allPartitions[i]);
+      } else {
+        u64 resumeAt;
+        {
+          SolutionWriter writer(name, 0, 8, -1, 3);
+          for (size_t i=0; i<half; i++) writer.Write(seeds[i], allSolutions[i], descriptors[i], allPartitions[i]);
+          bool synced = writer.Checkpoint(resumeAt);
+          assert(synced);
+          (void)synced;
+          writer.Write(seeds[half], allSolutions[0], descriptors[0], allPartitions[0]); // Cut off by the resume
+        }
+        SolutionWriter writer(name, 0, 8, resumeAt, 3);
+        for (size_t i=half; i<seeds.size(); i++) writer.Write(seeds[i], allSolutions[i], descriptors[i], allPartitions[i]);
+      }
+
+      File file(name);
+      SolutionReader reader(file);
+      assert(reader.Version() == version);
+      u32 seed, numSolutions;
+      Path path;
+      u64 partition;
+      // The reads are kept out of the asserts, since asserts are compiled out of release builds.
+      for (size_t i=0; i<seeds.size(); i++) {
+        bool read = reader.NextSeed(seed, numSolutions);
+        assert(read && seed == seeds[i] && numSolutions == (u32)allSolutions[i].Size());
+        if (!read) break;
+        if (reader.HasDescriptors()) {
+          const PuzzleDescriptor& descriptor = reader.Descriptor();
+          assert(descriptor.stars == descriptors[i].stars && descriptor.gaps == descriptors[i].gaps);
+          for (int k=0; k<2; k++) {
+            assert(descriptor.polyCells[k] == descriptors[i].polyCells[k] && descriptor.polyshapes[k] == descriptors[i].polyshapes[k]);
+          }
+        }
+        for (u32 k=0; k<numSolutions; k++) {
+          reader.NextSolution(path, &partition);
+          assert(path == allSolutions[i][k]);
+          assert(!reader.HasDescriptors() || partition == allPartitions[i][k]);
+        }
+      }
+      bool readPastEnd = reader.NextSeed(seed, numSolutions);
+      assert(!readPastEnd && !reader.Failed());
+      (void)readPastEnd;
+
+      SolutionIndex index(file);
+      size_t numChunks = version < 3 ? 0 : version < SolutionReader::VERSION ? (seeds.size() + 2) / 3 : (half + 2) / 3 + (seeds.size() - half + 2) / 3;
+      assert(index.NumChunks() == (int)numChunks);
+      for (size_t i=0; i<seeds.size() && version >= 3; i++) {
+        Vector<Path> solutions;
+        bool found = index.Find(seeds[i], solutions);
+        assert(found && solutions == allSolutions[i]);
+        (void)found;
+      }
+    }
+    remove(name.c_str());
     cout << "Done" << endl;
 
   } else if (argc > 1 && strcmp(argv[1], "period") == 0) {
@@ -361,74 +1049,429 @@ int main(int argc, char* argv[]) {
     // rng.Set(819664878);
     Puzzle* p = rng.GeneratePolyominos(false);
     cout << p->ToString() << endl;
-    auto solutions = Solver().Solve(p);
+    auto solutions = Solver().SolveParallel(p);
     delete p;
 
+  } else if (argc > 1 && strcmp(argv[1], "order") == 0) {
+    // Compares the move orders (see Solver::OrderMoves) by the time to find the first solution, which is what IsSolvable needs.
+    // Usage: order [numSeeds]
+    const int numSeeds = argc > 2 ? atoi(argv[2]) : 200;
+    const char* orderNames[] = {"Fixed", "NearestEnd", "Dots", "HugWalls"};
+    const int numOrders = sizeof(orderNames) / sizeof(orderNames[0]);
+
+    Solver solvers[numOrders];
+    for (int j=0; j<numOrders; j++) solvers[j].SetMoveOrder((MoveOrder)j);
+
+    cout << "generator";
+    for (int j=0; j<numOrders; j++) cout << "\t" << orderNames[j];
+    cout << "\t(microseconds per seed)" << endl;
+    Random rng;
+    for (int i=0; i<numGenerators; i++) {
+      chrono::nanoseconds totals[numOrders] = {};
+      for (int seed=1; seed<=numSeeds; seed++) {
+        rng.Set(seed);
+        Puzzle* p = Generate(rng, i);
+
+        // Solve the same puzzle with every order, so they all see the same mix of (un)solvable puzzles.
+        for (int j=0; j<numOrders; j++) {
+          auto start = chrono::steady_clock::now();
+          auto solutions = solvers[j].Solve(p, 1);
+          totals[j] += chrono::steady_clock::now() - start;
+        }
+        delete p;
+      }
+
+      cout << generatorNames[i];
+      for (int j=0; j<numOrders; j++) cout << "\t" << chrono::duration<double, micro>(totals[j]).count() / numSeeds;
+      cout << endl;
+    }
+
+  } else if (argc > 1 && strcmp(argv[1], "stats") == 0) {
+    // Shows where the solver spends its time for each generator (see SolverStats), including the solves which
+    // the generators themselves run.
+    // Usage: stats [numSeeds]
+    const int numSeeds = argc > 2 ? atoi(argv[2]) : 100;
+    PrintStatsHeader();
+    Random rng;
+    vector<LatencyTracker> latencies(numGenerators);
+    for (int i=0; i<numGenerators; i++) {
+      SolverStats::Reset();
+      for (int seed=1; seed<=numSeeds; seed++) {
+        auto seedStart = chrono::steady_clock::now();
+        u64 nodesBefore = SolverStats::Get().nodes;
+        rng.Set(seed);
+        Puzzle* p = Generate(rng, i);
+        auto solutions = Solver().Solve(p);
+        delete p;
+        auto seedTime = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - seedStart);
+        latencies[i].Add(seed, seedTime.count(), SolverStats::Get().nodes - nodesBefore);
+      }
+      PrintStats(generatorNames[i], SolverStats::Get(), numSeeds);
+    }
+    for (int i=0; i<numGenerators; i++) latencies[i].Print(generatorNames[i]);
+
+  } else if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    // Times the hot functions on a fixed corpus of seeds: The seeds from "test", plus the first |numSeeds| seeds.
+    // Prints one line of JSON per benchmark, so that runs can be diffed before starting a long sweep.
+    // Build with COUNT_ALLOCATIONS=1 to include the allocations per call.
+    // Usage: bench [numSeeds]
+    const int numSeeds = argc > 2 ? atoi(argv[2]) : 16;
+    vector<u32> seeds;
+    for (const auto& [initRng, endRng, numSolutions] : tests3) seeds.push_back(initRng);
+    for (int seed=1; seed<=numSeeds; seed++) seeds.push_back(seed);
+
+    Random rng;
+    size_t next = 0;
+    rng.Set(seeds[0]);
+    Bench("Random::Get", [&] { rng.Get(); });
+    Bench("Random::CheckStarsFailure", [&] {
+      rng.Set(seeds[next++ % seeds.size()]);
+      rng.CheckStarsFailure();
+    });
+    for (int i=0; i<numGenerators; i++) {
+      Bench("Random::Generate" + string(generatorNames[i]), [&] {
+        rng.Set(seeds[next++ % seeds.size()]);
+        delete Generate(rng, i);
+      });
+    }
+
+    // Generate the corpus up front, so that the remaining benchmarks only time the solver and validator.
+    // The polyomino, stars and stones puzzles (which don't have symmetry) also keep their solutions, for Validate and PolyFit.
+    vector<Puzzle*> puzzles;
+    vector<pair<Puzzle*, Path>> solvedPuzzles;
+    Solver solver;
+    for (int i=0; i<numGenerators; i++) {
+      size_t first = puzzles.size();
+      for (u32 seed : seeds) {
+        rng.Set(seed);
+        puzzles.push_back(Generate(rng, i));
+      }
+      Bench("Solver::Solve " + string(generatorNames[i]), [&] {
+        auto solutions = solver.Solve(puzzles[first + next++ % seeds.size()]);
+      });
+
+      if (i != 2 && i != 4 && i != 5) continue; // Stones, Polyominos, Stars
+      for (size_t j=first; j<puzzles.size(); j++) {
+        for (const Path& solution : solver.Solve(puzzles[j], 4)) solvedPuzzles.emplace_back(puzzles[j], solution.Copy());
+      }
+    }
+
+    vector<pair<Puzzle*, Region>> polyRegions;
+    for (auto& [puzzle, solution] : solvedPuzzles) {
+      if (!puzzle->_hasPolyominos) continue;
+      DrawPath(puzzle, solution, Line::Black);
+      for (u8 x=1; x<puzzle->_width; x+=2) {
+        for (u8 y=1; y<puzzle->_height; y+=2) {
+          if (puzzle->GetCell(x, y)->polyshape != 0) polyRegions.emplace_back(puzzle, puzzle->GetRegion(x, y));
+        }
+      }
+      DrawPath(puzzle, solution, Line::None);
+    }
+
+    Validator validator;
+    if (!solvedPuzzles.empty()) {
+      Bench("Validator::Validate", [&] {
+        auto& [puzzle, solution] = solvedPuzzles[next++ % solvedPuzzles.size()];
+        DrawPath(puzzle, solution, Line::Black);
+        validator.Validate(*puzzle);
+        DrawPath(puzzle, solution, Line::None);
+      });
+    }
+    if (!polyRegions.empty()) {
+      Bench("Polyominos::PolyFit", [&] {
+        auto& [puzzle, region] = polyRegions[next++ % polyRegions.size()];
+        Polyominos::PolyFit(region, *puzzle);
+      });
+    }
+    for (Puzzle* puzzle : puzzles) delete puzzle;
+
+  } else if (argc > 1 && strcmp(argv[1], "count") == 0) {
+    // Counts the paths through each puzzle (see PathDiagram), without enumerating them. For puzzles which only have gaps
+    // and dots (the mazes, symmetry, and dots pillar), this is exactly the number of solutions.
+    // Usage: count [numSeeds]
+    const int numSeeds = argc > 2 ? atoi(argv[2]) : 100;
+    cout << "generator\tmin\tmax\tmean\tsample (from the last seed)" << endl;
+    Random rng;
+    for (int i=0; i<numGenerators; i++) {
+      u64 minPaths = 0xFFFF'FFFF'FFFF'FFFF;
+      u64 maxPaths = 0;
+      double totalPaths = 0;
+      string sample;
+      for (int seed=1; seed<=numSeeds; seed++) {
+        rng.Set(seed);
+        Puzzle* p = Generate(rng, i);
+        PathDiagram diagram(p);
+        u64 numPaths = diagram.Count();
+        minPaths = min(minPaths, numPaths);
+        maxPaths = max(maxPaths, numPaths);
+        totalPaths += numPaths;
+        if (seed == numSeeds) {
+          Path path = diagram.Sample(rng);
+          for (u8 step : path) sample += to_string(step) + " ";
+        }
+        delete p;
+      }
+      cout << generatorNames[i] << "\t" << minPaths << "\t" << maxPaths << "\t" << totalPaths / numSeeds << "\t" << sample << endl;
+    }
+
   } else if (argc > 1 && strcmp(argv[1], "thrd") == 0) {
+    // thrd [--threads N] [--writers N] [--first SEED] [--last SEED] [--offset N] [--resume] [--stats [--no-files]]
+    // The solver threads generate and solve the seeds, then pass them to the writer threads, which record them in the
+    // files (and save the checkpoints), so that the solvers never wait for the disk.
+    // With --stats, the writers also build puzzle_solvability.dat and good.html as they go (the same as running "merge"
+    // and "good" afterwards), and with --no-files the thread_N_{good,bad}.dat files aren't written at all.
+    Checkpoint checkpoint;
+    u32 numWriters = 1;
+    bool computeStats = false;
+    bool writeFiles = true;
 #if _DEBUG
-    const int threadOffset = 0;
-    const int numThreads = 1;
-    const u32 initSeed = 0;
-    const u32 maxSeed = 0x4000;
+    checkpoint.numThreads = 1;
+    checkpoint.firstSeed = 1; // RNG starts at 1
+    checkpoint.lastSeed = 0x4000;
+    checkpoint.threadOffset = 0;
 #else
-    const int threadOffset = 48;
-    const int numThreads = 16;
-    const u32 initSeed = 0x6000'0000;
-    const u32 maxSeed = 0x7FFF'FFFE;
+    checkpoint.numThreads = max(1u, thread::hardware_concurrency());
+    checkpoint.firstSeed = 0x6000'0001;
+    checkpoint.lastSeed = 0x7FFF'FFFE;
+    checkpoint.threadOffset = 48;
 #endif
-    static_assert(maxSeed <= 0x7FFF'FFFE);
+    bool resume = false;
+    for (int i=2; i<argc; i++) {
+      if (strcmp(argv[i], "--resume") == 0) resume = true;
+      else if (strcmp(argv[i], "--stats") == 0) computeStats = true;
+      else if (strcmp(argv[i], "--no-files") == 0) writeFiles = false;
+      else if (i+1 < argc && strcmp(argv[i], "--threads") == 0) checkpoint.numThreads = (u32)strtoul(argv[++i], nullptr, 0);
+      else if (i+1 < argc && strcmp(argv[i], "--writers") == 0) numWriters = (u32)strtoul(argv[++i], nullptr, 0);
+      else if (i+1 < argc && strcmp(argv[i], "--first") == 0)   checkpoint.firstSeed = (u32)strtoul(argv[++i], nullptr, 0);
+      else if (i+1 < argc && strcmp(argv[i], "--last") == 0)    checkpoint.lastSeed = (u32)strtoul(argv[++i], nullptr, 0);
+      else if (i+1 < argc && strcmp(argv[i], "--offset") == 0)  checkpoint.threadOffset = (u32)strtoul(argv[++i], nullptr, 0);
+      else {
+        cout << "Unknown argument " << argv[i] << endl;
+        return 1;
+      }
+    }
+    if (!writeFiles && !computeStats) {
+      cout << "--no-files only makes sense with --stats" << endl;
+      return 1;
+    }
+    if (resume && computeStats) { // The statistics are only kept in memory, so they can't be resumed.
+      cout << "--stats needs the whole run, so it can't be resumed. Run \"merge\" and \"good\" on the files instead." << endl;
+      return 1;
+    }
+    // Seeds which take longer than this to solve have their trace (see Trace.h) written to thread_N_slow.txt
+    const auto slowSeed = chrono::milliseconds(500);
+    // How often the progress of each thread is saved to thrd_checkpoint.dat. With --resume, each thread truncates its
+    // files to the last checkpoint, redoes the blocks it had not finished, and carries on, rather than starting over.
+    // The settings from the checkpoint are used, not the ones on the command line.
+    const auto checkpointInterval = chrono::seconds(60);
+    const string checkpointName = "thrd_checkpoint.dat";
+    bool resuming = resume && checkpoint.Load(checkpointName);
+    if (!resuming) {
+      checkpoint.firstSeed = max(checkpoint.firstSeed, 1u);
+      checkpoint.lastSeed = min(checkpoint.lastSeed, 0x7FFF'FFFEu);
+      if (checkpoint.numThreads == 0 || numWriters == 0 || checkpoint.firstSeed > checkpoint.lastSeed) {
+        cout << "Nothing to do" << endl;
+        return 1;
+      }
+      checkpoint.threads.resize(checkpoint.numThreads);
+    }
+    cout << (resuming ? "Resuming" : "Solving") << " seeds 0x" << hex << checkpoint.firstSeed << "-0x" << checkpoint.lastSeed << dec;
+    cout << " on " << checkpoint.numThreads << " threads" << endl;
+    SeedScheduler scheduler(checkpoint, checkpointName);
+
+    numWriters = min(numWriters, checkpoint.numThreads);
+
+    // Each solver thread sends its seeds to one of the writer threads through its own Pipe, so the seeds stay in order.
+    // If the writers fall behind, the rings fill up and the solvers wait, instead of queueing up more and more puzzles.
+    struct Pipe {
+      RingBuffer<SolvedSeed> ring{256};
+      SolutionWriter* goodSolutions = nullptr;
+      FileWriter* badFile = nullptr;
+      size_t finishedBlocks = 0; // Since the last checkpoint
+      chrono::steady_clock::time_point lastCheckpoint = chrono::steady_clock::now();
+    };
+    Vector<Pipe*> pipes(checkpoint.numThreads);
+    for (u32 i=0; i<checkpoint.numThreads; i++) {
+      string prefix = "thread_" + to_string(i + checkpoint.threadOffset);
+      const Checkpoint::Thread& start = checkpoint.threads[i];
+      bool resumeFiles = resuming && start.goodOffset != 0;
+      Pipe* pipe = new Pipe();
+      if (writeFiles) {
+        // Polyomino puzzles always start in the bottom left
+        pipe->goodSolutions = new SolutionWriter(prefix + "_good.dat", 0, 8, resumeFiles ? (s64)start.goodOffset : -1);
+        bool opened = !pipe->goodSolutions->Failed();
+        if (opened) { // Otherwise, leave the bad file alone too.
+          pipe->badFile = new FileWriter(prefix + "_bad.dat", resumeFiles ? (s64)start.badOffset : -1);
+          opened = !pipe->badFile->Failed();
+        }
+        if (!opened) {
+          if (resumeFiles) cout << "Could not resume " << prefix << "_good.dat and " << prefix << "_bad.dat (they are missing, or don't match " << checkpointName << ")" << endl;
+          else             cout << "Could not create " << prefix << "_good.dat and " << prefix << "_bad.dat" << endl;
+          return 1;
+        }
+      }
+      pipes.Push(pipe);
+    }
+    // Set once a writer fails to save a checkpoint (e.g. the disk is full). The solvers stop taking new blocks, and
+    // the checkpoint is left at the last point where everything was really on disk, so that --resume can carry on.
+    atomic<bool> failed = false;
+    Solvability* solvability = computeStats ? new Solvability() : nullptr;
+    vector<PolyStatistics> polyStatistics(numWriters); // One per writer
+
+    SolverStats totalStats;
+    u64 totalSeeds = 0;
+    LatencyTracker totalLatency;
+    std::mutex statsLock;
     Vector<thread> threads;
-    for (u32 i=0; i<numThreads; i++) {
+    for (u32 i=0; i<checkpoint.numThreads; i++) {
       thread t([&](int i) {
-        auto goodFile = CreateFileA(("thread_" + to_string(i+threadOffset) + "_good.dat").c_str(), FILE_GENERIC_WRITE, NULL, nullptr, CREATE_ALWAYS, NULL, nullptr);
-        auto badFile  = CreateFileA(("thread_" + to_string(i+threadOffset) + "_bad.dat").c_str(),  FILE_GENERIC_WRITE, NULL, nullptr, CREATE_ALWAYS, NULL, nullptr);
+        string prefix = "thread_" + to_string(i + checkpoint.threadOffset);
+        bool resumeFiles = resuming && checkpoint.threads[i].goodOffset != 0;
+        ofstream slowFile(prefix + "_slow.txt", resumeFiles ? ios::app : ios::trunc);
+        RingBuffer<SolvedSeed>& ring = pipes[i]->ring;
+        SolvedSeed item;
+        auto Send = [&]() {
+          while (!ring.TryPush(item)) this_thread::yield(); // The writer is behind
+        };
 
         Random rng;
         Solver solver;
-        for (u32 j=0;; j++) {
-          u32 seed = initSeed + 1 + i + (j * numThreads); // RNG starts at 1
-          if (seed > maxSeed) break;
-          rng.Set(seed);
+        SolverStats::Reset();
+        u64 numSeeds = 0;
+        LatencyTracker latency;
+        u32 firstSeed, lastSeed;
+        while (!failed && scheduler.NextBlock(i, firstSeed, lastSeed)) {
+          for (u32 seed = firstSeed; seed <= lastSeed; seed++) {
+            numSeeds++;
+            rng.Set(seed);
+            auto seedStart = chrono::steady_clock::now();
+            u64 nodesBefore = SolverStats::Get().nodes;
+            Trace::Clear();
+            Trace::Record(TraceEvent::Seed, seed);
+
+            bool starsFailure = rng.CheckStarsFailure() > 2; // The first two rolls are always needed, see "merge"
+            Puzzle* p = rng.GeneratePolyominos(false); // Even if stars fail, we still want to roll the RNG to find the endRng.
+
+            Vector<Path> solutions;
+            if (!starsFailure) { // If stars fail, then we will hit this seed in another thread, and there's no reason to solve.
+              solutions = solver.Solve(p);
+            }
+            auto seedTime = chrono::steady_clock::now() - seedStart;
+            latency.Add(seed, chrono::duration_cast<chrono::nanoseconds>(seedTime).count(), SolverStats::Get().nodes - nodesBefore);
+            if (seedTime > slowSeed) {
+              slowFile << "Seed " << seed << " took " << chrono::duration<double, milli>(seedTime).count() << "ms" << endl;
+              Trace::Dump(slowFile);
+            }
+
+            item.kind = SolvedSeed::Kind::Seed;
+            item.seed = seed;
+            item.endingRng = rng.Peek();
+            item.puzzle = p;
+            item.solutions = move(solutions);
+            Send();
+          }
+          item.kind = SolvedSeed::Kind::EndOfBlock;
+          Send();
+        }
+        item.kind = SolvedSeed::Kind::Finished;
+        Send();
 
-          bool starsFailure = rng.CheckStarsFailure();
-          Puzzle* p = rng.GeneratePolyominos(false); // Even if stars fail, we still want to roll the RNG to find the endRng.
+        std::lock_guard<std::mutex> guard(statsLock);
+        totalStats += SolverStats::Get();
+        totalSeeds += numSeeds;
+        totalLatency.Merge(latency);
+      }, i);
+      threads.Emplace(move(t));
+    }
 
-          Vector<Path> solutions;
-          if (!starsFailure) { // If stars fail, then we will hit this seed in another thread, and there's no reason to solve.
-            solutions = solver.Solve(p);
+    // Writer w looks after every numWriters'th pipe, starting from pipe w.
+    for (u32 w=0; w<numWriters; w++) {
+      thread t([&](u32 w) {
+        auto SaveCheckpoint = [&](u32 i) {
+          Pipe& pipe = *pipes[i];
+          if (!writeFiles) return;
+          u64 goodOffset;
+          bool synced = pipe.goodSolutions->Checkpoint(goodOffset) && pipe.badFile->Sync();
+          if (!synced || !scheduler.SaveCheckpoint(i, pipe.finishedBlocks, goodOffset, pipe.badFile->Offset())) {
+            if (!failed.exchange(true)) cout << "Could not write the files for thread " << i << " (or the checkpoint), stopping" << endl;
+            return;
           }
+          pipe.finishedBlocks = 0;
+          pipe.lastCheckpoint = chrono::steady_clock::now();
+        };
 
-          u32 endingRng = rng.Peek();
-          if (solutions.Empty()) {
-            WriteFile(badFile, &seed, sizeof(seed), nullptr, nullptr);
-            WriteFile(badFile, &endingRng, sizeof(endingRng), nullptr, nullptr);
-            SetFilePointer(badFile, 0, nullptr, FILE_END);
-          } else {
-            WriteFile(goodFile, &seed, sizeof(seed), nullptr, nullptr);
-            int numSolutions = solutions.Size();
-            WriteFile(goodFile, &numSolutions, sizeof(numSolutions), nullptr, nullptr);
-            for (const auto& solution : solutions) {
-              WriteFile(goodFile, &solution[0], sizeof(u8) * solution.Size(), nullptr, nullptr);
+        Random rng;
+        PuzzleDescriptor descriptor;
+        vector<u64> partitions;
+        SolvedSeed item;
+        u32 numPipes = (checkpoint.numThreads - w + numWriters - 1) / numWriters;
+        for (u32 numFinished = 0; numFinished < numPipes;) {
+          bool idle = true;
+          for (u32 i=w; i<checkpoint.numThreads; i += numWriters) {
+            Pipe& pipe = *pipes[i];
+            while (pipe.ring.TryPop(item)) {
+              idle = false;
+              if (item.kind == SolvedSeed::Kind::Seed) {
+                if (item.solutions.Empty()) {
+                  if (writeFiles) {
+                    pipe.badFile->WriteInt(item.seed);
+                    pipe.badFile->WriteInt(item.endingRng);
+                  }
+                  if (computeStats) solvability->MarkUnsolvable(rng, item.seed);
+                } else {
+                  descriptor = PuzzleDescriptor::Describe(item.puzzle);
+                  partitions.clear();
+                  for (const Path& solution : item.solutions) partitions.push_back(PuzzleDescriptor::Partition(item.puzzle, solution));
+                  if (writeFiles) pipe.goodSolutions->Write(item.seed, item.solutions, descriptor, partitions);
+                  if (computeStats) polyStatistics[w].Add(descriptor, partitions);
+                }
+                delete item.puzzle;
+                item.puzzle = nullptr;
+              } else if (item.kind == SolvedSeed::Kind::EndOfBlock) {
+                pipe.finishedBlocks++;
+                if (chrono::steady_clock::now() - pipe.lastCheckpoint > checkpointInterval) SaveCheckpoint(i);
+              } else {
+                // So that resuming a finished run just rewrites the index (which comes after the checkpoint).
+                SaveCheckpoint(i);
+                numFinished++;
+              }
             }
-            // string puzzleStr = p->ToString();
-            // WriteFile(goodFile, puzzleStr.c_str(), (DWORD)(sizeof(char) * puzzleStr.size()), nullptr, nullptr);
-            SetFilePointer(goodFile, 0, nullptr, FILE_END);
           }
-          delete p;
+          if (idle) this_thread::sleep_for(chrono::microseconds(100)); // The solvers are behind
         }
-        CloseHandle(badFile);
-        CloseHandle(goodFile);
-      }, i);
+      }, w);
       threads.Emplace(move(t));
     }
 
-    for (int i=0; i<numThreads; i++) {
+    for (int i=0; i<threads.Size(); i++) {
       if (threads[i].joinable()) threads[i].join();
     }
+    // Deleting the writers writes the index at the end of each good file, and closes the files.
+    for (Pipe* pipe : pipes) {
+      delete pipe->goodSolutions;
+      delete pipe->badFile;
+      delete pipe;
+    }
+    if (failed) {
+      cout << "Stopped early. Once there is room on the disk, run thrd --resume to carry on from the last checkpoint." << endl;
+      return 1;
+    }
+
+    if (computeStats) {
+      if (!solvability->Save("puzzle_solvability.dat")) cout << "Could not write puzzle_solvability.dat" << endl;
+      delete solvability;
+      for (u32 w=1; w<numWriters; w++) polyStatistics[0].Merge(polyStatistics[w]);
+      ofstream report("good.html");
+      streambuf* console = cout.rdbuf(report.rdbuf()); // PolyStatistics::Print writes to cout
+      polyStatistics[0].Print();
+      cout.rdbuf(console);
+    }
+
+    PrintStatsHeader();
+    PrintStats("Polyominos", totalStats, totalSeeds);
+    totalLatency.Print("Polyominos");
   } else if (argc > 1 && strcmp(argv[1], "merge") == 0) {
-    Vector<u16> finalData(1 << 27); // A single bit per seed
-    std::mutex dataLock;
-    finalData.Fill((u8)0xFF);
+    Solvability solvability;
 
 #if _DEBUG
     const int numThreads = 1;
@@ -439,7 +1482,6 @@ int main(int argc, char* argv[]) {
 
     for (u32 i=0; i<numThreads; i++) {
       thread t([&](int i) {
-        Vector<u16> threadData = finalData.Copy();
         Random rng;
         for (int j = i;; j+=numThreads) {
           File badFile("thread_" + to_string(j) + "_bad.dat");
@@ -453,32 +1495,9 @@ int main(int argc, char* argv[]) {
             // if (initialSeed == 0x000041a7) DebugBreak();
             // if (initialSeed == 1) DebugBreak();
 
-            rng.Set(initialSeed);
-            // While generating data, we do not differentiate a generation failure from an unsolvable puzzle, as both incur a reroll.
-            // However, for the purposes of computing solvability, we only want to denote actualy unsolvable puzzles,
-            // ergo we  need to skip any puzzles which failed due to a stars failure.
-            int rerollCount = rng.CheckStarsFailure();
-            if (rerollCount > 2) continue;
-
-            // We use a value based on the initial seed here, because the final seed is not actually unique!
-            // Two puzzles may share a final seed if they had different polyomino sizes, since differently-sized polyominos
-            // will increment the RNG a different number of times. Ergo, differentiating based on the end RNG is not possible.
-            // Instead, we use the initial seed. However, if a puzzle fails, we jump to just before the starts failure,
-            // which means *that* moment is the "initial" seed for re-rolls. To avoid extra normalization, we always use that location,
-            // which is 11 RNG steps beyond the initial seed, +2 for the stars roll.
-            for (int k=0; k<13; k++) rng.Get();
-            // if (rng.Peek() == 0x6a5d128c) DebugBreak();
-
-            // Computing *solvability* here
-            threadData[rng.Peek() >> 4] &= ~(1 << (rng.Peek() % 16));
+            solvability.MarkUnsolvable(rng, initialSeed);
           }
         }
-
-        dataLock.lock();
-        for (int j=0; j<threadData.Size(); j++) {
-          finalData[j] &= threadData[j];
-        }
-        dataLock.unlock();
       }, i);
       threads.Emplace(move(t));
     }
@@ -487,8 +1506,77 @@ int main(int argc, char* argv[]) {
     }
 
     // This file can probably be checked in, honestly. It's only about 256 MB, which is /annoying/ to clone but not that big of a deal. Especially since it'll never change.
-    auto output = CreateFileA("puzzle_solvability.dat", FILE_GENERIC_WRITE, NULL, nullptr, CREATE_ALWAYS, NULL, nullptr);
-    WriteFile(output, &finalData[0], finalData.Size() * sizeof(finalData[0]), nullptr, nullptr);
+    if (!solvability.Save("puzzle_solvability.dat")) {
+      cout << "Could not write puzzle_solvability.dat" << endl;
+      return 1;
+    }
+
+  } else if (argc > 1 && strcmp(argv[1], "convert") == 0) {
+    // Rewrites any older thread_N_good.dat files in the current format (smaller, searchable, and with puzzle descriptors).
+    // Current files are skipped.
+    for (int i = 0;; i++) {
+      string name = "thread_" + to_string(i) + "_good.dat";
+      u64 numSeeds = 0;
+      bool converted = false;
+      {
+        File input(name);
+        if (input.Done()) break; // File did not exist
+        SolutionReader reader(input);
+        if (reader.Version() == SolutionReader::VERSION) continue;
+
+        SolutionWriter writer(name + ".tmp", 0, 8);
+        Random rng;
+        u32 seed, numSolutions;
+        while (reader.NextSeed(seed, numSolutions)) {
+          Vector<Path> solutions(numSolutions);
+          for (u32 j=0; j<numSolutions; j++) {
+            Path solution;
+            reader.NextSolution(solution);
+            solutions.Emplace(std::move(solution));
+          }
+          rng.Set(seed); // Older files don't describe the puzzles, so we have to regenerate them.
+          Puzzle* p = rng.GeneratePolyominos(false);
+          writer.Write(seed, solutions, p);
+          delete p;
+          numSeeds++;
+        }
+        u64 size;
+        converted = !reader.Failed() && writer.Checkpoint(size);
+      } // Close both files before replacing the original
+      if (!converted) { // Keep the original, so that nothing is lost.
+        remove((name + ".tmp").c_str());
+        cout << "Could not convert " << name << " (it is corrupt, or the new file could not be written)" << endl;
+        continue;
+      }
+      remove(name.c_str());
+      rename((name + ".tmp").c_str(), name.c_str());
+      cout << "Converted " << name << " (" << numSeeds << " seeds)" << endl;
+    }
+
+  } else if (argc > 2 && strcmp(argv[1], "seed") == 0) {
+    // Looks up the solutions to a single seed, using the index at the end of each thread_N_good.dat.
+    u32 seed = (u32)strtoul(argv[2], nullptr, 0);
+    bool found = false;
+    for (int i = 0; !found; i++) {
+      File goodFile("thread_" + to_string(i) + "_good.dat");
+      if (goodFile.Size() == 0) break; // File did not exist
+      SolutionIndex index(goodFile);
+      if (index.NumChunks() == 0) {
+        cout << "thread_" << i << "_good.dat has no index (it is from an older version, or thrd did not finish)" << endl;
+        continue;
+      }
+
+      Vector<Path> solutions;
+      if (!index.Find(seed, solutions)) continue;
+      found = true;
+      cout << "Seed 0x" << hex << seed << dec << " (thread_" << i << "_good.dat) has " << solutions.Size() << " solutions" << endl;
+      for (const Path& solution : solutions) {
+        cout << "(" << (int)solution[0] << ", " << (int)solution[1] << ") ";
+        for (int j=2; solution[j] != PATH_NONE; j++) cout << "?LRTB"[solution[j]];
+        cout << endl;
+      }
+    }
+    if (!found) cout << "Seed 0x" << hex << seed << dec << " was not found (it is unsolvable, or hasn't been run yet)" << endl;
 
   } else if (argc > 1 && strcmp(argv[1], "good") == 0) {
     // using Polykey = u32;
@@ -499,15 +1587,41 @@ int main(int argc, char* argv[]) {
     // };
     // unordered_map<Polykey, Data> data;
 
-    unordered_map<u32, unordered_map<u64, u32>> combinedPolyshapes;
-    unordered_map<u32, unordered_map<u64, u32>> uniquePolyshapes;
-    unordered_map<u32, u32> totalPuzzles;
-    unordered_map<u32, u32[4]> starStatistics;
-    u64 totalPolysTogether = 0;
-    u64 totalPolysApart = 0;
-    u64 totalPolysBoth = 0;
+    // Adds every record from |goodSolutions| (a SolutionReader or a SolutionChunk) to |stats|.
+    // Returns false if the records stopped early because the file is corrupt.
+    auto addSeeds = [](auto& goodSolutions, PolyStatistics& stats, Random& rng) {
+      u32 seed, numSolutions;
+      Path solution;
+      PuzzleDescriptor descriptor;
+      vector<u64> partitions;
+      while (goodSolutions.NextSeed(seed, numSolutions)) {
+        // Current files describe the puzzle, so we only need to regenerate it for older files.
+        Puzzle* p = nullptr;
+        if (goodSolutions.HasDescriptors()) {
+          descriptor = goodSolutions.Descriptor();
+        } else {
+          rng.Set(seed);
+          p = rng.GeneratePolyominos(false);
+          descriptor = PuzzleDescriptor::Describe(p);
+        }
+
+        partitions.clear();
+        for (; numSolutions > 0; numSolutions--) {
+          u64 partition;
+          goodSolutions.NextSolution(solution, &partition);
+          if (p) partition = PuzzleDescriptor::Partition(p, solution);
+          partitions.push_back(partition);
+        }
+        stats.Add(descriptor, partitions);
 
+        delete p;
+      }
+      return !goodSolutions.Failed();
+    };
+
+    PolyStatistics stats;
     Random rng;
+    const u32 numThreads = max(1u, thread::hardware_concurrency());
 #if _DEBUG
     for (int i = 0; i < 1; i++) {
 #else
@@ -517,216 +1631,35 @@ int main(int argc, char* argv[]) {
       File goodFile("thread_" + to_string(i) + "_good.dat");
       if (goodFile.Done()) break; // File did not exist
 
-      while (!goodFile.Done()) { // Read through the entire file
-        u32 seed = goodFile.GetInt();
-        rng.Set(seed);
-        Puzzle* p = rng.GeneratePolyominos(false);
-
-        Cell* firstPoly = nullptr;
-        Cell* secondPoly = nullptr;
-        bool canContainStars = false;
-        bool canExcludeStars = false;
-        std::unordered_set<u64> validPolyshapes;
-
-        // Compute polyshapes
-        for (u8 x = 1; x < p->_width; x += 2) {
-          for (u8 y = 1; y < p->_height; y += 2) {
-            Cell* cell = p->GetCell(x, y);
-            u16 polyshape = cell->polyshape;
-            if (polyshape == 0) continue;
-
-            if (!firstPoly) {
-              firstPoly = cell;
-            } else {
-              secondPoly = cell;
-              break;
+      // If the file has an index, each thread takes the next chunk until there are none left, and keeps its own
+      // statistics (which don't depend on the order the puzzles are added in). Otherwise, read through the entire file.
+      SolutionIndex index(goodFile);
+      if (index.NumChunks() > 0) {
+        vector<PolyStatistics> threadStats(numThreads);
+        atomic<int> nextChunk = 0;
+        atomic<int> numCorrupt = 0;
+        vector<thread> threads;
+        for (u32 j=0; j<numThreads; j++) {
+          threads.emplace_back([&, j] {
+            Random threadRng;
+            SolutionChunk chunk;
+            for (int k = nextChunk++; k < index.NumChunks(); k = nextChunk++) {
+              if (!index.ReadChunk(k, chunk) || !addSeeds(chunk, threadStats[j], threadRng)) numCorrupt++;
             }
-          }
-        }
-
-        struct NormalizedPolys {
-          u16 poly1 = 0xFFFF;
-          u16 poly2 = 0xFFFF;
-          u8 rotation = 0;
-          bool flip = false;
-        } min;
-
-        assert(firstPoly);
-        assert(secondPoly);
-        u16 polyshape1 = firstPoly->polyshape;
-        u16 polyshape2 = secondPoly->polyshape;
-        bool flipped = false;
-        u8 rotation = 0;
-
-        for (u8 j=0; j<8; j++) {
-          if (j == 4) {
-            polyshape1 = Polyominos::Flip(polyshape1);
-            polyshape2 = Polyominos::Flip(polyshape2);
-            flipped = !flipped;
-            rotation -= 2;
-          } else {
-            polyshape1 = Polyominos::RotatePolyshape(polyshape1);
-            polyshape2 = Polyominos::RotatePolyshape(polyshape2);
-            rotation++;
-          }
-          polyshape1 = Polyominos::Normalize(polyshape1);
-          polyshape2 = Polyominos::Normalize(polyshape2);
-
-          for (int k=0; k<2; k++) {
-            if (__popcnt16(polyshape1) < __popcnt16(min.poly1)
-             || __popcnt16(polyshape1) == __popcnt16(min.poly1) && polyshape1 < min.poly1
-             || __popcnt16(polyshape1) == __popcnt16(min.poly1) && polyshape1 == min.poly1 && __popcnt16(polyshape2) < __popcnt16(min.poly2)
-             || __popcnt16(polyshape1) == __popcnt16(min.poly1) && polyshape1 == min.poly1 && __popcnt16(polyshape2) == __popcnt16(min.poly2) && polyshape2 < min.poly2) {
-              min.poly1 = polyshape1;
-              min.poly2 = polyshape2;
-              min.rotation = rotation;
-              min.flip = flipped;
-            }
-            swap(polyshape1, polyshape2); // To avoid writing the above logic twice
-          }
-        }
-        u32 polyKey = 0;
-        // If the left-hand poly (poly2) fills the right-most column, shift the right-hand poly one row.
-        // Due to the minimization, we will never have 4-wide polyominos -- only 4-tall.
-        if (min.poly2 & 0xF000) min.poly1 <<= 4;
-        polyKey = (min.poly1 << 16) | min.poly2;
-
-        // Compute all solution paths by reading from file
-        for(u32 numSolutions = goodFile.GetInt(); numSolutions > 0; numSolutions--) {
-          p->ClearGrid(true);
-          u8 x = goodFile.Get();
-          u8 y = goodFile.Get();
-          assert(x == 0 && y == 8);
-          while (true) { // Trace the solution path
-            Cell* cell = p->GetCell(x, y);
-            assert(cell);
-            cell->line = Line::Black;
-            u8 dir = goodFile.Get();
-            if (dir == PATH_NONE) break;
-            else if (dir == PATH_LEFT)   x--;
-            else if (dir == PATH_RIGHT)  x++;
-            else if (dir == PATH_TOP)    y--;
-            else if (dir == PATH_BOTTOM) y++;
-          }
-
-          Region region = p->GetRegion(firstPoly->x, firstPoly->y);
-          bool sameRegion = false;
-          bool containsStars = false;
-          for (Cell* cell : region) {
-            if (cell == secondPoly) sameRegion = true;
-            if (cell->type == Type::Star) containsStars = true;
-          }
-
-          if (sameRegion) {
-            u64 polyish = p->GetPolyishFromMaskedGrid(min.rotation, min.flip);
-            assert(__popcnt16(min.poly1) + __popcnt16(min.poly2) == __popcnt64(polyish));
-            validPolyshapes.insert(polyish);
-          } else {
-            validPolyshapes.insert(0);
-          }
-          if (containsStars) canContainStars = true;
-          else               canExcludeStars = true;
-        } // done with puzzle
-
-        for (u64 polyish : validPolyshapes) combinedPolyshapes[polyKey][polyish]++;
-        if (validPolyshapes.size() == 1) uniquePolyshapes[polyKey][*validPolyshapes.begin()]++;
-        totalPuzzles[polyKey]++;
-
-        u8 starsValue = (canContainStars ? 1 : 0) + (canExcludeStars ? 2 : 0);
-        starStatistics[polyKey][starsValue]++;
-
-        if (validPolyshapes.find(0) == validPolyshapes.end()) {
-          totalPolysTogether++; // No configuration allows the polys to be apart
-        } else {
-          if (validPolyshapes.size() == 1) {
-            totalPolysApart++; // There is only one configuration and it has the polys apart
-          } else {
-            totalPolysBoth++; // There are multiple configurations allowing apart & together
-          }
-        }
-
-        delete p;
-      } // done reading file
-    }
-
-    // Start of file, etc.
-    cout << R"(<html>
-<head>
-  <style>
-    * {
-      font-family: Constantia;
-    }
-    pre, .polykey {
-      white-space: pre;
-      font-family: monospace;
-    }
-    td {
-      border: 1px solid black;
-      border-collapse: collapse;
-      padding: 2px;
-      text-align: center;
-      width: 50px;
-    }
-  </style>
-</head>
-<body>)";
-
-    u64 uberTotal = 0;
-    u64 uberUnique = 0;
-    // u64 totalStarsContained = 0;
-    // u64 totalStarsExcluded = 0;
-    // u64 totalStarsBoth = 0;
-
-    vector<pair<u32, u32>> sortedPolyshapes;
-    for (const auto& [polykey, total] : totalPuzzles) {
-      uberTotal += total;
-      for (const auto& [polyish, count] : uniquePolyshapes[polykey]) uberUnique += count;
-      sortedPolyshapes.emplace_back(polykey, total);
-    }
-    sort(sortedPolyshapes.begin(), sortedPolyshapes.end(), [](const pair<u32, u32>& a, const pair<u32, u32>& b) { return a.second > b.second; });
-
-    cout << "There are a total of " << uberTotal << " polyominos + stars puzzles<br>\n";
-    cout << uberUnique << " (" << (100.0f * uberUnique / uberTotal) << "%) of these puzzles can only be solved with one configuration<br>\n";
-    cout << totalPolysTogether << " puzzles (" << (100.0f * totalPolysTogether) / uberTotal << "% of all puzzles) must be solved with the polyominos combined<br>\n";
-    cout << totalPolysApart << " puzzles (" << (100.0f * totalPolysApart) / uberTotal << "% of all puzzles) must be solved with the polyominos separated<br>\n";
-    cout << totalPolysBoth << " puzzles (" << (100.0f * totalPolysBoth) / uberTotal << "% of all puzzles) can be solved either way<br>\n";
-    assert(uberTotal == totalPolysTogether + totalPolysApart + totalPolysBoth);
-    cout << "<br><span class='anchor' id='table-of-contents'><h2>Table of contents</h2></span>";
-    GenerateTables(totalPuzzles, uberTotal);
-    cout << fixed; // no scientific notation please
-
-    for (const auto& [polykey, total] : sortedPolyshapes) {
-      const auto& combinedData = combinedPolyshapes[polykey];
-      const auto& uniqueData = uniquePolyshapes[polykey];
-      u32 uniqueTotal = 0;
-      for (const auto& [key2, data2] : uniqueData) uniqueTotal += data2;
-
-      cout << "<span class='anchor' id='" << polykey << "'></span>";
-      cout << "---------------------------------------------------------------------------------------------------------------------------------------<br>\n";
-      cout << "<small><a href='#table-of-contents'>Jump to top</a></small><br>\n";
-      cout << "This pair of polyominos is present in " << total << " puzzles (" << (100.0f * total) / uberTotal << "% of all puzzles)<br>\n";
-      cout << "Of those puzzles, " << uniqueTotal << " (" << (100.0f * uniqueTotal / total) << "%) can only be solved with one configuration of polyominos<br>\n";
-      cout << "<pre>" << PrintPolykey(polykey) << "</pre>";
-
-      vector<pair<u64, u32>> items;
-      for (const auto& it : combinedData) items.push_back(it);
-      sort(items.begin(), items.end(), [](const pair<u64, u32>& a, const pair<u64, u32>& b) { return a.second > b.second; });
-
-      for (const auto& [polyish, count] : items) {
-        u32 uniqueCount = uniqueData.at(polyish);
-
-        if (polyish == 0) {
-          cout << count << " (" << (100.0f * count) / total << "%) of these puzzles can be solved with the polyominos separated<br>\n";
-          cout << uniqueCount << " (" << (100.0f * uniqueCount) / total << "%) of these puzzles must be solved with the polyominos separated<br>\n";
-        } else {
-          cout << count << " (" << (100.0f * count) / total << "%) of these puzzles can be solved with the polyominos in this configuration:<br>\n";
-          cout << uniqueCount << " (" << (100.0f * uniqueCount) / total << "%) of these puzzles must be solved with the polyominos in this configuration:<br>\n";
-          cout << "<pre>" << PrintPolyish(polyish, 8, 8, polykey) << "</pre>";
+          });
         }
+        for (thread& t : threads) t.join();
+        for (const PolyStatistics& threadStat : threadStats) stats.Merge(threadStat);
+        // The report goes to cout, so errors go to cerr.
+        if (numCorrupt > 0) cerr << "thread_" << i << "_good.dat has " << numCorrupt << " corrupt chunks, which were (partly) skipped" << endl;
+        continue;
       }
+
+      SolutionReader goodSolutions(goodFile);
+      if (!addSeeds(goodSolutions, stats, rng)) cerr << "thread_" << i << "_good.dat is corrupt, so reading stopped at the bad chunk" << endl;
     }
 
-    cout << "</body></html>";
+    stats.Print();
   }
 
   return 0;
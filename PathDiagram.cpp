@@ -0,0 +1,408 @@
+#include "stdafx.h"
+#include <algorithm>
+#include <unordered_map>
+
+// Vertex ids. The source connects to every start point, and the sink connects to every endpoint,
+// so the diagram only has to count paths from the source to the sink.
+constexpr u16 SOURCE = 0;
+constexpr u16 SINK = 1;
+constexpr u16 NO_VERTEX = 0xFFFF;
+// Values for _need
+constexpr u8 NEED_ANY = 2;
+// Returned by Decide when the child is not a terminal
+constexpr u32 NOT_TERMINAL = 0xFFFF'FFFF;
+
+static u8 FlipNeed(u8 need, u8 voltage) {
+  return need == NEED_ANY ? NEED_ANY : need ^ voltage;
+}
+
+PathDiagram::PathDiagram(Puzzle* puzzle) {
+  _puzzle = puzzle;
+  _vertexOf = new NArray<u16>(puzzle->_width, puzzle->_height);
+  _vertexOf->Fill(NO_VERTEX);
+
+  _cells.push_back(nullptr); // SOURCE
+  _cells.push_back(nullptr); // SINK
+  for (u8 x=0; x<puzzle->_width; x++) {
+    for (u8 y=0; y<puzzle->_height; y++) {
+      Cell* cell = puzzle->GetCell(x, y);
+      if (!IsTraversable(cell)) continue;
+      if (puzzle->_symmetry != SYM_NONE) {
+        // The reflection shares a vertex with its cell. Whichever one we see first is the one stored in _cells.
+        Cell* symCell = puzzle->GetSymmetricalCell(cell);
+        u16 symVertex = _vertexOf->Get(symCell->x, symCell->y);
+        if (symVertex != NO_VERTEX) {
+          _vertexOf->Get(x, y) = symVertex;
+          continue;
+        }
+      }
+      _vertexOf->Get(x, y) = (u16)_cells.size();
+      _cells.push_back(cell);
+    }
+  }
+
+  _required.assign(_cells.size(), 0);
+  _need.assign(_cells.size(), NEED_ANY);
+  _need[SOURCE] = 0; // The path starts on sheet 0 by definition, see the voltage on the start edges.
+
+  for (u8 x=0; x<puzzle->_width; x++) {
+    for (u8 y=0; y<puzzle->_height; y++) {
+      Cell* cell = puzzle->GetCell(x, y);
+      if (cell->dot == Dot::None) continue;
+      u16 vertex = _vertexOf->Get(x, y);
+      if (vertex == NO_VERTEX) { // The dot is on a gap, or on the axis of symmetry
+        _impossible = true;
+        continue;
+      }
+
+      u8 need = NEED_ANY;
+      if (puzzle->_symmetry != SYM_NONE) {
+        // The path we trace is the blue line, so blue dots must be on the path, and yellow dots on its reflection.
+        if (cell->dot == Dot::Blue) need = Sheet(cell);
+        else if (cell->dot == Dot::Yellow) need = Sheet(cell) ^ 1;
+      }
+      _required[vertex] = 1;
+      if (_need[vertex] == NEED_ANY) {
+        _need[vertex] = need;
+      } else if (need != NEED_ANY && need != _need[vertex]) {
+        _impossible = true; // e.g. a blue dot which is the reflection of another blue dot
+      }
+    }
+  }
+
+  for (u8 x=0; x<puzzle->_width; x++) {
+    for (u8 y=0; y<puzzle->_height; y++) {
+      u16 vertex = _vertexOf->Get(x, y);
+      if (vertex == NO_VERTEX) continue;
+      Cell* cell = puzzle->GetCell(x, y);
+      if (cell->start) AddEdge(SOURCE, vertex, Sheet(cell));
+      // Puzzle::SetEnd always adds the reflected endpoint too, so either cell can be the end of the path.
+      if (cell->end != End::None) AddEdge(SINK, vertex, 0);
+
+      Cell* neighbors[2] = {puzzle->GetCell(x + 1, y), puzzle->GetCell(x, y + 1)};
+      for (Cell* neighbor : neighbors) {
+        if (neighbor == nullptr) continue;
+        u16 neighborVertex = _vertexOf->Get(neighbor->x, neighbor->y);
+        if (neighborVertex == NO_VERTEX || neighborVertex == vertex) continue;
+        AddEdge(vertex, neighborVertex, Sheet(cell) ^ Sheet(neighbor));
+      }
+    }
+  }
+
+  if (!_impossible) Build();
+}
+
+PathDiagram::~PathDiagram() {
+  delete _vertexOf;
+}
+
+u64 PathDiagram::Count() const {
+  if (_counts.empty()) return 0;
+  return _counts[2]; // The root
+}
+
+int PathDiagram::NumNodes() const {
+  return (int)_nodes.size();
+}
+
+bool PathDiagram::IsTraversable(Cell* cell) {
+  // Same rules as Solver::IsTraversable, plus the reflection must be a line, since the path may be on either cell.
+  if (cell == nullptr || cell->type != Type::Line) return false;
+  if (cell->gap != Gap::None) return false;
+  if (_puzzle->_symmetry != SYM_NONE) {
+    Cell* symCell = _puzzle->GetSymmetricalCell(cell);
+    if (_puzzle->MatchesSymmetricalPos(cell->x, cell->y, symCell->x, symCell->y)) return false;
+    if (symCell->type != Type::Line || symCell->gap != Gap::None) return false;
+  }
+  return true;
+}
+
+u8 PathDiagram::Sheet(Cell* cell) const {
+  return _cells[_vertexOf->Get(cell->x, cell->y)] == cell ? 0 : 1;
+}
+
+Cell* PathDiagram::Lift(u16 vertex, u8 sheet) const {
+  Cell* cell = _cells[vertex];
+  return sheet == 0 ? cell : _puzzle->GetSymmetricalCell(cell);
+}
+
+void PathDiagram::AddEdge(u16 a, u16 b, u8 voltage) {
+  // In symmetry puzzles, we see every edge twice (once from each side). The reflected edge has the same voltage.
+  for (const Edge& edge : _edges) {
+    if (edge.a == a && edge.b == b && edge.voltage == voltage) return;
+    if (edge.a == b && edge.b == a && edge.voltage == voltage) return;
+  }
+  _edges.push_back({a, b, voltage});
+}
+
+void PathDiagram::Build() {
+  // Process the edges in grid order (the source and sink edges go with their cell), so that the frontier stays
+  // about one column wide.
+  std::stable_sort(_edges.begin(), _edges.end(), [](const Edge& e1, const Edge& e2) {
+    u16 low1 = e1.a <= SINK ? e1.b : std::min(e1.a, e1.b);
+    u16 low2 = e2.a <= SINK ? e2.b : std::min(e2.a, e2.b);
+    if (low1 != low2) return low1 < low2;
+    u16 high1 = e1.a <= SINK ? e1.b : std::max(e1.a, e1.b);
+    u16 high2 = e2.a <= SINK ? e2.b : std::max(e2.a, e2.b);
+    return high1 < high2;
+  });
+
+  int numEdges = (int)_edges.size();
+  int numVertices = _cells.size();
+  std::vector<int> first(numVertices, -1);
+  std::vector<int> last(numVertices, -1);
+  for (int i=0; i<numEdges; i++) {
+    for (u16 vertex : {_edges[i].a, _edges[i].b}) {
+      if (first[vertex] == -1) first[vertex] = i;
+      last[vertex] = i;
+    }
+  }
+  if (first[SOURCE] == -1 || first[SINK] == -1) return; // No start or no end
+  for (int v=0; v<numVertices; v++) {
+    if (_required[v] && first[v] == -1) return; // A dot which the path can never reach
+  }
+
+  _active.assign(numEdges + 1, {});
+  _entering.assign(numEdges, {});
+  _leaving.assign(numEdges, {});
+  _requiredAfter.assign(numEdges, 0);
+  for (int v=0; v<numVertices; v++) {
+    if (first[v] == -1) continue;
+    _entering[first[v]].push_back((u16)v);
+    _leaving[last[v]].push_back((u16)v);
+    for (int i=first[v] + 1; i<=last[v]; i++) _active[i].push_back((u16)v);
+    for (int i=0; i<first[v]; i++) _requiredAfter[i] += _required[v];
+  }
+  _mate.assign(numVertices, 0);
+  _deg.assign(numVertices, 0);
+  _rel.assign(numVertices, 0);
+  _fragmentNeed.assign(numVertices, NEED_ANY);
+
+  _nodes.push_back({0, 0}); // False terminal
+  _nodes.push_back({0, 0}); // True terminal
+  _nodes.push_back({0, 0}); // Root
+  std::vector<u32> layer = {2};
+  std::vector<std::string> layerStates = {""};
+  std::string childState;
+  for (int i=0; i<numEdges; i++) {
+    std::unordered_map<std::string, u32> nextIndex;
+    std::vector<u32> nextLayer;
+    std::vector<std::string> nextStates;
+    for (int j=0; j<layer.size(); j++) {
+      for (bool take : {false, true}) {
+        u32 child = Decide(i, layerStates[j], take, childState);
+        if (child == NOT_TERMINAL) {
+          auto [it, inserted] = nextIndex.try_emplace(childState, (u32)_nodes.size());
+          if (inserted) {
+            _nodes.push_back({0, 0});
+            nextLayer.push_back(it->second);
+            nextStates.push_back(childState);
+          }
+          child = it->second;
+        }
+        if (take) _nodes[layer[j]].hi = child;
+        else      _nodes[layer[j]].lo = child;
+      }
+    }
+    layer = std::move(nextLayer);
+    layerStates = std::move(nextStates);
+  }
+  assert(layer.empty()); // Every path either finishes or fails by the last edge
+
+  // Children are always created after their parents, so counting backwards visits the children first.
+  _counts.assign(_nodes.size(), 0);
+  _counts[1] = 1;
+  for (int n=(int)_nodes.size() - 1; n>=2; n--) {
+    u64 lo = _counts[_nodes[n].lo];
+    u64 hi = _counts[_nodes[n].hi];
+    _counts[n] = (lo + hi < lo) ? 0xFFFF'FFFF'FFFF'FFFF : lo + hi;
+  }
+}
+
+// Each vertex on the frontier is stored as 3 bytes: The mate (2 bytes), then the degree, relative sheet, and need.
+// Vertices which are not the end of a path fragment store only their degree, so that equivalent states merge.
+void PathDiagram::Load(int i, const std::string& state) {
+  const std::vector<u16>& active = _active[i];
+  for (int j=0; j<active.size(); j++) {
+    u16 vertex = active[j];
+    u8 info = (u8)state[3*j + 2];
+    _deg[vertex] = info & 0x3;
+    if (_deg[vertex] == 1) {
+      _mate[vertex] = (u16)((u8)state[3*j] | ((u8)state[3*j + 1] << 8));
+      _rel[vertex] = (info >> 2) & 0x1;
+      _fragmentNeed[vertex] = (info >> 3) & 0x3;
+    } else {
+      _mate[vertex] = vertex;
+      _rel[vertex] = 0;
+      _fragmentNeed[vertex] = _need[vertex];
+    }
+  }
+  for (u16 vertex : _entering[i]) {
+    _mate[vertex] = vertex;
+    _deg[vertex] = 0;
+    _rel[vertex] = 0;
+    _fragmentNeed[vertex] = _need[vertex];
+  }
+}
+
+u32 PathDiagram::Decide(int i, const std::string& state, bool take, std::string& childState) {
+  Load(i, state);
+
+  if (take) {
+    const Edge& edge = _edges[i];
+    u16 a = edge.a;
+    u16 b = edge.b;
+    u8 maxDegA = (a == SOURCE || a == SINK) ? 1 : 2;
+    u8 maxDegB = (b == SOURCE || b == SINK) ? 1 : 2;
+    if (_deg[a] >= maxDegA || _deg[b] >= maxDegB) return 0;
+
+    // Joining two fragments (or single vertices): a's fragment ends at |endA|, b's fragment at |endB|.
+    u16 endA = _deg[a] == 0 ? a : _mate[a];
+    u16 endB = _deg[b] == 0 ? b : _mate[b];
+    if (endA == b) return 0; // Would close a loop
+
+    // Express both fragments' requirements in terms of a's sheet, and make sure they agree.
+    u8 needA = _fragmentNeed[a];
+    u8 needB = FlipNeed(_fragmentNeed[b], edge.voltage);
+    if (needA != NEED_ANY && needB != NEED_ANY && needA != needB) return 0;
+    u8 need = (needA != NEED_ANY) ? needA : needB;
+    u8 relA = _deg[a] == 0 ? 0 : _rel[a];
+    u8 relB = _deg[b] == 0 ? 0 : _rel[b];
+
+    _deg[a]++;
+    _deg[b]++;
+    // Note that the ends may have left the frontier already (if they are the source or sink), in which case
+    // these writes are just ignored.
+    _mate[endA] = endB;
+    _mate[endB] = endA;
+    _rel[endA] = _rel[endB] = relA ^ edge.voltage ^ relB;
+    _fragmentNeed[endA] = FlipNeed(need, relA);
+    _fragmentNeed[endB] = FlipNeed(need, edge.voltage ^ relB);
+
+    if ((endA == SOURCE && endB == SINK) || (endA == SINK && endB == SOURCE)) {
+      // The path is complete, so every remaining edge must be skipped.
+      return CanComplete(i) ? 1 : 0;
+    }
+  }
+
+  for (u16 vertex : _leaving[i]) {
+    if (vertex == SOURCE || vertex == SINK) {
+      if (_deg[vertex] != 1) return 0;
+    } else {
+      if (_deg[vertex] == 1) return 0; // A dangling path fragment
+      if (_deg[vertex] == 0 && _required[vertex]) return 0; // An uncovered dot
+    }
+  }
+  if (i == (int)_edges.size() - 1) return 0; // We never connected the source to the sink
+
+  const std::vector<u16>& active = _active[i + 1];
+  childState.resize(3 * active.size());
+  for (int j=0; j<active.size(); j++) {
+    u16 vertex = active[j];
+    if (_deg[vertex] == 1) {
+      childState[3*j] = (char)(_mate[vertex] & 0xFF);
+      childState[3*j + 1] = (char)(_mate[vertex] >> 8);
+      childState[3*j + 2] = (char)(_deg[vertex] | (_rel[vertex] << 2) | (_fragmentNeed[vertex] << 3));
+    } else {
+      childState[3*j] = 0;
+      childState[3*j + 1] = 0;
+      childState[3*j + 2] = (char)_deg[vertex];
+    }
+  }
+  return NOT_TERMINAL;
+}
+
+bool PathDiagram::CanComplete(int i) {
+  if (_requiredAfter[i] > 0) return false; // There's a dot we haven't reached yet
+  for (const std::vector<u16>* vertices : {&_active[i], &_entering[i]}) {
+    for (u16 vertex : *vertices) {
+      if (vertex == SOURCE || vertex == SINK) continue;
+      if (_deg[vertex] == 1) return false; // A dangling path fragment
+      if (_deg[vertex] == 0 && _required[vertex]) return false; // An uncovered dot
+    }
+  }
+  return true;
+}
+
+Path PathDiagram::Sample(Random& rng) const {
+  Path path;
+  if (Count() == 0) return path;
+
+  // Pick which path we want, then walk down the diagram to find it.
+  u64 target = (((u64)(u32)rng.Get() << 32) | (u32)rng.Get()) % Count();
+  std::vector<int> chosenEdges;
+  u32 node = 2;
+  for (int i=0; node > 1; i++) {
+    u64 hiCount = _counts[_nodes[node].hi];
+    if (target < hiCount) {
+      chosenEdges.push_back(i);
+      node = _nodes[node].hi;
+    } else {
+      target -= hiCount;
+      node = _nodes[node].lo;
+    }
+  }
+  assert(node == 1);
+
+  return Trace(chosenEdges);
+}
+
+bool PathDiagram::Enumerate(const std::function<bool(const Path&)>& visit) const {
+  if (Count() == 0) return true;
+  std::vector<int> chosenEdges;
+  return Enumerate(2, 0, chosenEdges, visit);
+}
+
+bool PathDiagram::Enumerate(u32 node, int i, std::vector<int>& chosenEdges, const std::function<bool(const Path&)>& visit) const {
+  if (node == 1) return visit(Trace(chosenEdges));
+  // Only follow children with a nonzero count, i.e. where both halves of the path can be completed. Thus, every branch leads to a path.
+  // Taking the edge first matches the order that Sample uses.
+  if (_counts[_nodes[node].hi] > 0) {
+    chosenEdges.push_back(i);
+    bool keepGoing = Enumerate(_nodes[node].hi, i + 1, chosenEdges, visit);
+    chosenEdges.pop_back();
+    if (!keepGoing) return false;
+  }
+  if (_counts[_nodes[node].lo] > 0) {
+    if (!Enumerate(_nodes[node].lo, i + 1, chosenEdges, visit)) return false;
+  }
+  return true;
+}
+
+Path PathDiagram::Trace(const std::vector<int>& chosenEdges) const {
+  Path path;
+  // Every vertex on the path has one or two chosen edges.
+  std::vector<int> edgesAt(2 * _cells.size(), -1);
+  for (int i : chosenEdges) {
+    for (u16 vertex : {_edges[i].a, _edges[i].b}) {
+      int slot = edgesAt[2 * vertex] == -1 ? 2 * vertex : 2 * vertex + 1;
+      edgesAt[slot] = i;
+    }
+  }
+
+  // Follow the edges from the source to the sink, tracking which sheet we're on so that we trace the real cells.
+  int edgeIndex = edgesAt[2 * SOURCE];
+  u16 vertex = _edges[edgeIndex].b;
+  u8 sheet = _edges[edgeIndex].voltage;
+  Cell* cell = Lift(vertex, sheet);
+  path.Ensure(2 * _cells.size() + 3);
+  path.UnsafePush(cell->x);
+  path.UnsafePush(cell->y);
+  while (true) {
+    edgeIndex = (edgesAt[2 * vertex] == edgeIndex) ? edgesAt[2 * vertex + 1] : edgesAt[2 * vertex];
+    const Edge& edge = _edges[edgeIndex];
+    if (edge.a == SINK) break;
+
+    vertex = (edge.a == vertex) ? edge.b : edge.a;
+    sheet ^= edge.voltage;
+    Cell* next = Lift(vertex, sheet);
+    if (next == _puzzle->GetCell(cell->x - 1, cell->y))      path.UnsafePush(PATH_LEFT);
+    else if (next == _puzzle->GetCell(cell->x + 1, cell->y)) path.UnsafePush(PATH_RIGHT);
+    else if (next == _puzzle->GetCell(cell->x, cell->y - 1)) path.UnsafePush(PATH_TOP);
+    else if (next == _puzzle->GetCell(cell->x, cell->y + 1)) path.UnsafePush(PATH_BOTTOM);
+    else assert(false);
+    cell = next;
+  }
+  path.UnsafePush(PATH_NONE);
+  return path;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "forward.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// A frontier-based decision diagram (a la Knuth's simpath) of every path through a puzzle which:
+// - Starts at a start point and finishes at an endpoint
+// - Does not go through gaps
+// - Covers every dot (with the correct color of line, for symmetry puzzles)
+// - Does not collide with its reflection (for symmetry puzzles)
+// No other symbols are considered, so use the Validator on sampled paths if the puzzle has any.
+// Unlike Solver::Solve, this does not enumerate the paths, so it can count (and uniformly sample) far more of them.
+//
+// Symmetry puzzles are handled by merging each cell with its reflection, so that a path in the diagram visits
+// each pair of cells at most once. Each edge tracks whether it crosses between the two halves of a pair,
+// which is enough to know which actual cell (and therefore which color of line) the path is on.
+class PathDiagram {
+public:
+  PathDiagram(Puzzle* puzzle);
+  ~PathDiagram();
+  DELETE_RO3(PathDiagram)
+  DELETE_RO5(PathDiagram)
+
+  // The number of paths. Saturates at 0xFFFF'FFFF'FFFF'FFFF (which is far beyond anything a 7x7 can reach).
+  u64 Count() const;
+  int NumNodes() const;
+  // Returns one of the paths, chosen uniformly at random, in the same format as Solver::Solve.
+  // Returns an empty path if there are no paths.
+  Path Sample(Random& rng) const;
+  // Calls |visit| on every path, in the same format as Solver::Solve, until it returns false.
+  // Returns false if |visit| stopped the enumeration early.
+  bool Enumerate(const std::function<bool(const Path&)>& visit) const;
+
+private:
+  struct Edge {
+    u16 a; u16 b;
+    u8 voltage; // 1 if this edge connects a's cell to the reflection of b's cell.
+  };
+  struct Node {
+    u32 lo; u32 hi; // Children if we skip / take the edge. 0 and 1 are the false and true terminals.
+  };
+
+  bool IsTraversable(Cell* cell);
+  u8 Sheet(Cell* cell) const; // 0 if |cell| is the one stored in _cells, 1 if it's the reflection.
+  Cell* Lift(u16 vertex, u8 sheet) const;
+  void AddEdge(u16 a, u16 b, u8 voltage);
+  void Build();
+
+  // Helpers for Build. Layer i holds the state of every vertex on the frontier before deciding edge i.
+  void Load(int i, const std::string& state);
+  // Returns the terminal (0 or 1) if deciding edge i this way finishes the path, otherwise writes |childState|.
+  u32 Decide(int i, const std::string& state, bool take, std::string& childState);
+  bool CanComplete(int i);
+  bool Enumerate(u32 node, int i, std::vector<int>& chosenEdges, const std::function<bool(const Path&)>& visit) const;
+  // Converts a set of chosen edges (which must form a path from the source to the sink) into a Path.
+  Path Trace(const std::vector<int>& chosenEdges) const;
+
+  Puzzle* _puzzle;
+  bool _impossible = false;
+  NArray<u16>* _vertexOf;
+  std::vector<Cell*> _cells; // One per vertex (nullptr for the source and sink)
+  std::vector<u8> _required; // Per vertex, 1 if it has a dot
+  std::vector<u8> _need;     // Per vertex, which sheet a dot forces the path onto (see NEED_ANY in the .cpp)
+  std::vector<Edge> _edges;
+  std::vector<Node> _nodes;
+  std::vector<u64> _counts;
+
+  // Per edge: the vertices on the frontier, the vertices which join it, and the vertices which leave after it.
+  std::vector<std::vector<u16>> _active;
+  std::vector<std::vector<u16>> _entering;
+  std::vector<std::vector<u16>> _leaving;
+  std::vector<int> _requiredAfter; // Number of dots which first appear after edge i
+  // Scratch state for the vertices on the current frontier
+  std::vector<u16> _mate; // For path ends, the vertex at the other end of the path fragment
+  std::vector<u8> _deg;
+  std::vector<u8> _rel;   // For path ends, the sheet of this end xor the sheet of the other end
+  std::vector<u8> _fragmentNeed; // For path ends, which sheet this end must be on (or NEED_ANY)
+};
@@ -38,6 +38,7 @@ Polyomino Polyominos::PolyominoFromPolyshape(u16 polyshape) {
 }
 
 bool Polyominos::PolyFit(const Region& region, const Puzzle& puzzle) {
+  SolverStats::Get().polyFits++;
   vector<Cell*> polys;
   vector<Cell*> ylops;
   s8 polyCount = 0;
@@ -85,16 +86,20 @@ bool Polyominos::PolyFit(const Region& region, const Puzzle& puzzle) {
 
 bool Polyominos::TryPlacePolyshape(const Polyomino& cells, u8 x, u8 y, const Puzzle& puzzle, NArray<s8>& polyGrid, s8 sign) {
   console.spam("Placing at", x, y, "with sign", sign);
+  if (sign > 0) SolverStats::Get().placements++;
   Vector<s8> values((int)cells.size());
+  // Go through GetCell for the grid coordinates, since polyominos may wrap around pillars.
   for (u8 i=0; i<cells.size(); i++) {
     auto [cellX, cellY] = cells[i];
-    if (puzzle.GetCell(cellX + x, cellY + y) == nullptr) return false;
-    s8 puzzleCell = polyGrid(cellX + x, cellY + y);
+    Cell* cell = puzzle.GetCell(cellX + x, cellY + y);
+    if (cell == nullptr) return false;
+    s8 puzzleCell = polyGrid(cell->x, cell->y);
     values.UnsafePush(puzzleCell);
   }
   for (u8 i=0; i<cells.size(); i++) {
     auto [cellX, cellY] = cells[i];
-    polyGrid(cellX + x, cellY + y) = values[i] + sign;
+    Cell* cell = puzzle.GetCell(cellX + x, cellY + y);
+    polyGrid(cell->x, cell->y) = values[i] + sign;
   }
   return true;
 }
@@ -7,10 +7,18 @@ Puzzle::Puzzle(u8 width, u8 height, bool pillar) {
   _origHeight = height;
   _width = 2*width + (pillar ? 0 : 1);
   _height = 2*height+1;
+  _pillar = pillar;
   _numConnections = (width+1)*height + width*(height+1);
 
+  for (int i=0; i<256; i++) {
+    s8 x = (s8)i;
+    if (pillar) _columns[i] = (u8)((x % _width + _width) % _width);
+    else _columns[i] = (x >= 0 && x < _width) ? (u8)x : 0xFF;
+  }
+
   _grid = new NArray<Cell>(_width, _height);
   _grid->Fill(Cell{});
+  _cells = &_grid->Get(0, 0);
   _maskedGrid = new NArray<Masked>(_width, _height);
   _maskedGrid->Fill(Masked::Uncounted);
 
@@ -52,10 +60,27 @@ Puzzle::~Puzzle() {
   if (_connections) delete _connections;
 }
 
-Cell* Puzzle::GetCell(s8 x, s8 y) const {
-  x = _mod(x);
-  if (!_safeCell(x, y)) return nullptr;
-  return &_grid->Get(x, y);
+Puzzle* Puzzle::Copy() const {
+  Puzzle* copy = new Puzzle(_origWidth, _origHeight, _pillar);
+  copy->_numConnections = _numConnections;
+  copy->_symmetry = _symmetry;
+  copy->_name = _name;
+  copy->_hasNegations = _hasNegations;
+  copy->_hasPolyominos = _hasPolyominos;
+
+  for (u8 x=0; x<_width; x++) {
+    for (u8 y=0; y<_height; y++) {
+      copy->_grid->Get(x, y) = _grid->Get(x, y);
+      copy->_maskedGrid->Get(x, y) = _maskedGrid->Get(x, y);
+    }
+  }
+  copy->_connections->Resize(0);
+  for (u8 connection : *_connections) copy->_connections->Push(connection);
+
+  // These point into our grid, so they need to point into the copied grid instead.
+  if (_startPoint) copy->_startPoint = &copy->_grid->Get(_startPoint->x, _startPoint->y);
+  if (_endPoint) copy->_endPoint = &copy->_grid->Get(_endPoint->x, _endPoint->y);
+  return copy;
 }
 
 void Puzzle::SetStart(s8 x, s8 y) {
@@ -111,7 +136,7 @@ pair<u8, u8> Puzzle::GetSymmetricalPos(s8 x, s8 y) {
       y = (_height - 1) - y;
     }
   }
-  return {_mod(x), y};
+  return {_columns[(u8)x], y};
 }
 
 Cell* Puzzle::GetSymmetricalCell(Cell* cell) {
@@ -120,18 +145,7 @@ Cell* Puzzle::GetSymmetricalCell(Cell* cell) {
 }
 
 bool Puzzle::MatchesSymmetricalPos(s8 x1, s8 y1, s8 x2, s8 y2) {
-  return (y1 == y2 && _mod(x1) == x2);
-}
-
-u8 Puzzle::_mod(s8 x) const {
-  if (_pillar == false) return x;
-  return (x + 2 * _width * _height) % _width;
-}
-
-bool Puzzle::_safeCell(s8 x, s8 y) const {
-  if (x < 0 || x >= _width) return false;
-  if (y < 0 || y >= _height) return false;
-  return true;
+  return (y1 == y2 && _columns[(u8)x1] == x2);
 }
 
 Line Puzzle::GetLine(s8 x, s8 y) const {
@@ -170,12 +184,13 @@ void Puzzle::_floodFill(u8 x, u8 y, Region& region) {
   }
   _maskedGrid->Get(x, y) = Masked::Processed;
 
-  if (y < _height - 1)       _floodFill(x,        y + 1, region);
-  if (y > 0)                 _floodFill(x,        y - 1, region);
-  if (x < _width - 1)        _floodFill(x + 1,        y, region);
-  else if (_pillar != false) _floodFill(0,            y, region);
-  if (x > 0)                 _floodFill(x - 1,        y, region);
-  else if (_pillar != false) _floodFill(_width-1,     y, region);
+  if (y < _height - 1) _floodFill(x, y + 1, region);
+  if (y > 0)           _floodFill(x, y - 1, region);
+  // The column table wraps around pillars, and returns 0xFF past the edge otherwise.
+  u8 right = _columns[(u8)(x + 1)];
+  if (right != 0xFF)   _floodFill(right, y, region);
+  u8 left = _columns[(u8)(x - 1)];
+  if (left != 0xFF)    _floodFill(left, y, region);
 }
 
 void Puzzle::GenerateMaskedGrid() {
@@ -254,6 +269,7 @@ void Puzzle::GetRegions(Vector<Region>& regions, LinearAllocator<Cell*>& alloc)
       // This will also mark all lines inside the new region as used.
       Region region(remainingRegionSize, alloc);
       _floodFill(x, y, region);
+      SolverStats::Get().regionsComputed++;
       remainingRegionSize -= region.Size();
       regions.Emplace(move(region));
     }
@@ -265,27 +281,38 @@ Region Puzzle::GetRegion(s8 x, s8 y) {
 
   Cell* cell = GetCell(x, y);
   if (cell == nullptr) return region;
-  x = cell->x; // Hacky, substitute for calling _mod.
+  x = cell->x; // The column that GetCell wrapped x to
 
   GenerateMaskedGrid();
   if (_maskedGrid->Get(x, y) != Masked::Processed) {
     // If the masked grid hasn't been used at this point, then create a new region.
     // This will also mark all lines inside the new region as used.
     _floodFill(x, y, region);
+    SolverStats::Get().regionsComputed++;
   }
 
   return region;
 }
 
 u64 Puzzle::GetPolyishFromMaskedGrid(u8 rotation, bool flip) {
-  u64 polyish = 0;
+  u64 cells = 0;
   for (u8 x=1; x<_width; x+=2) {
     Masked* col = _maskedGrid->GetRow(x);
     for (u8 y=1; y<_height; y+=2) {
-      if (col[y] != Masked::Processed) continue;
+      if (col[y] == Masked::Processed) cells |= (u64)1 << ((x - 1) / 2 * 8 + (y - 1) / 2);
+    }
+  }
+  return GetPolyish(cells, rotation, flip);
+}
+
+u64 Puzzle::GetPolyish(u64 cells, u8 rotation, bool flip) {
+  u64 polyish = 0;
+  for (u8 x=0; x<8; x++) {
+    for (u8 y=0; y<8; y++) {
+      if ((cells & ((u64)1 << (x * 8 + y))) == 0) continue;
 
-      u8 newX = (x - 1) / 2;
-      u8 newY = (y - 1) / 2;
+      u8 newX = x;
+      u8 newY = y;
       if (flip) {
         newY = 7 - newY;
       }
@@ -20,8 +20,10 @@ private:
   End end = (End)0;
   bool start = false;
 
+  friend class PathDiagram;
   friend class Puzzle;
   friend class Solver;
+  friend class Validator;
 };
 
 class Puzzle {
@@ -48,11 +50,15 @@ public:
   ~Puzzle();
   DELETE_RO3(Puzzle)
   DELETE_RO5(Puzzle)
+  // Deep copy of the grid and all puzzle properties, for callers which need to mutate a puzzle independently
+  // (e.g. each thread in Solver::SolveParallel).
+  Puzzle* Copy() const;
 
   // Start/end setters, for safety reasons
   void SetStart(s8 x, s8 y);
   void SetEnd(s8 x, s8 y, End dir);
 
+  // Called for every step of the solver, so this is inline (see below).
   Cell* GetCell(s8 x, s8 y) const;
   std::pair<u8, u8> GetSymmetricalPos(s8 x, s8 y);
   Cell* GetSymmetricalCell(Cell* cell);
@@ -68,6 +74,8 @@ public:
   Region GetRegion(s8 x, s8 y);
   // Works for up to an 8x8 region
   u64 GetPolyishFromMaskedGrid(u8 rotation, bool flip);
+  // Same as above, but for a region given as one bit per cell (bit x * 8 + y, where x and y count cells, not lines).
+  static u64 GetPolyish(u64 cells, u8 rotation, bool flip);
 
   std::string ToString(); // Can be imported into TW
   void LogGrid();
@@ -82,10 +90,20 @@ public:
 
 private:
   NArray<Cell>* _grid;
+  Cell* _cells; // The storage behind _grid (column-major), so that GetCell can index it directly.
 
-  u8 _mod(s8 x) const;
-  bool _safeCell(s8 x, s8 y) const;
+  // The grid column for every x coordinate (indexed by (u8)x, so negative coordinates work too). On a pillar, every
+  // coordinate wraps around to a column, and otherwise the ones outside of the grid map to 0xFF.
+  // This is how GetCell wraps around pillars without branching on x.
+  u8 _columns[256];
 
   friend class Solver;
   friend class Validator;
 };
+
+inline Cell* Puzzle::GetCell(s8 x, s8 y) const {
+  // Casting to u8 also catches negative coordinates. The bitwise or (rather than ||) keeps this a single branch.
+  u8 column = _columns[(u8)x];
+  if ((column == 0xFF) | ((u8)y >= _height)) return nullptr;
+  return &_cells[column * _height + y];
+}
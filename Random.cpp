@@ -496,6 +496,8 @@ bool Random::IsSolvable(int seed) {
 
 static Solver solver;
 
+// The fixed (LRUD) move order finds the first solution fastest for every generator. Re-check with "order" in Main.cpp
+// before changing it here.
 bool Random::IsSolvable(Puzzle* p) {
   return !solver.Solve(p, 1).Empty();
 }
\ No newline at end of file
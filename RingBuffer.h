@@ -0,0 +1,51 @@
+#pragma once
+#include "forward.h"
+#include <atomic>
+#include <vector>
+
+// A bounded queue from exactly one producer thread to exactly one consumer thread. Neither side ever takes a lock:
+// each side owns one of the two counters, and only reads the other one (and caches it, so that the cache line holding
+// it isn't pulled across on every call). When the queue is full TryPush fails, which is how a slow consumer pushes
+// back on the producer, and keeps the memory in flight bounded.
+template <typename T>
+class RingBuffer {
+public:
+  // |capacity| must be a power of 2.
+  RingBuffer(u32 capacity) : _slots(capacity), _mask(capacity - 1) {
+    assert((capacity & _mask) == 0);
+  }
+  DELETE_RO3(RingBuffer);
+
+  // Producer only. Moves |value| into the queue, unless the queue is full (in which case |value| is left alone).
+  bool TryPush(T& value) {
+    u64 tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _headCache == _slots.size()) {
+      _headCache = _head.load(std::memory_order_acquire);
+      if (tail - _headCache == _slots.size()) return false;
+    }
+    _slots[tail & _mask] = std::move(value);
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Moves the oldest value in the queue into |value|, or returns false if the queue is empty.
+  bool TryPop(T& value) {
+    u64 head = _head.load(std::memory_order_relaxed);
+    if (head == _tailCache) {
+      _tailCache = _tail.load(std::memory_order_acquire);
+      if (head == _tailCache) return false;
+    }
+    value = std::move(_slots[head & _mask]);
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::vector<T> _slots;
+  u64 _mask;
+  // The counters only ever go up, and are masked to find the slot.
+  alignas(64) std::atomic<u64> _head = 0; // The next slot to pop. Written by the consumer.
+  u64 _tailCache = 0;                     // The consumer's copy of _tail
+  alignas(64) std::atomic<u64> _tail = 0; // The next slot to push. Written by the producer.
+  u64 _headCache = 0;                     // The producer's copy of _head
+};
@@ -0,0 +1,449 @@
+#include "stdafx.h"
+#include "SolutionFile.h"
+#include <algorithm>
+
+using namespace std;
+
+// The records are decoded the same way from a File (SolutionReader) or from memory (SolutionChunk),
+// so these are templated on where the bytes come from. |Source| just needs a Get().
+struct MemorySource {
+  const u8*& position;
+  u8 Get() { return *position++; }
+};
+
+template <typename Source>
+static u64 ReadVarint(Source& source) {
+  u64 value = 0;
+  for (int shift=0;; shift+=7) {
+    u8 byte = source.Get();
+    value |= (u64)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return value;
+  }
+}
+
+template <typename Source>
+static u64 ReadBytes(Source& source, int numBytes) { // Little-endian
+  u64 value = 0;
+  for (int i=0; i<numBytes; i++) value |= (u64)source.Get() << (8 * i);
+  return value;
+}
+
+template <typename Source>
+static void ReadSeed(Source& source, u8 version, u32& previousSeed, u32& seed, u32& numSolutions, PuzzleDescriptor& descriptor) {
+  seed = previousSeed + (u32)ReadVarint(source);
+  previousSeed = seed;
+  numSolutions = (u32)ReadVarint(source);
+  if (version < 4) return;
+
+  descriptor.stars = (u16)ReadBytes(source, 2);
+  descriptor.gaps = ReadBytes(source, 5);
+  u8 polyCells = source.Get();
+  descriptor.polyCells[0] = polyCells & 0xF;
+  descriptor.polyCells[1] = polyCells >> 4;
+  descriptor.polyshapes[0] = (u16)ReadBytes(source, 2);
+  descriptor.polyshapes[1] = (u16)ReadBytes(source, 2);
+}
+
+template <typename Source>
+static void ReadSolution(Source& source, u8 version, u8 startX, u8 startY, Path& path, u64* partition) {
+  path.Resize(0);
+  path.Push(startX);
+  path.Push(startY);
+  int numMoves = (int)ReadVarint(source);
+  for (int i=0; i<numMoves; i+=4) {
+    u8 byte = source.Get();
+    for (int j=0; j<4 && i+j < numMoves; j++) path.Push(((byte >> (2 * j)) & 0x3) + 1);
+  }
+  path.Push(PATH_NONE);
+
+  if (version < 4) return;
+  u64 value = ReadBytes(source, sizeof(u64));
+  if (partition) *partition = value;
+}
+
+PuzzleDescriptor PuzzleDescriptor::Describe(Puzzle* puzzle) {
+  assert(puzzle->_width == 9 && puzzle->_height == 9);
+  PuzzleDescriptor descriptor;
+  int numPolys = 0;
+  int edge = 0;
+  for (u8 x=0; x<puzzle->_width; x++) {
+    for (u8 y=0; y<puzzle->_height; y++) {
+      Cell* cell = puzzle->GetCell(x, y);
+      if (x % 2 == 1 && y % 2 == 1) {
+        u8 index = (x / 2) * 4 + y / 2;
+        if (cell->type == Type::Star) descriptor.stars |= 1 << index;
+        if (cell->polyshape != 0) {
+          assert(numPolys < 2);
+          descriptor.polyCells[numPolys] = index;
+          descriptor.polyshapes[numPolys] = cell->polyshape;
+          numPolys++;
+        }
+      } else if (x % 2 != y % 2) {
+        if (cell->gap != Gap::None) descriptor.gaps |= (u64)1 << edge;
+        edge++;
+      }
+    }
+  }
+  assert(numPolys == 2);
+  return descriptor;
+}
+
+u64 PuzzleDescriptor::Partition(Puzzle* puzzle, const Path& solution) {
+  puzzle->ClearGrid(true);
+  s8 x = solution[0];
+  s8 y = solution[1];
+  for (int i=2;; i++) { // Trace the solution path
+    puzzle->GetCell(x, y)->line = Line::Black;
+    u8 dir = solution[i];
+    if (dir == PATH_NONE) break;
+    else if (dir == PATH_LEFT)   x--;
+    else if (dir == PATH_RIGHT)  x++;
+    else if (dir == PATH_TOP)    y--;
+    else if (dir == PATH_BOTTOM) y++;
+  }
+
+  u64 partition = 0;
+  u16 labeled = 0;
+  u8 numRegions = 0;
+  for (u8 index=0; index<16; index++) {
+    if (labeled & (1 << index)) continue;
+    Region region = puzzle->GetRegion((index / 4) * 2 + 1, (index % 4) * 2 + 1);
+    for (Cell* cell : region) {
+      if (cell->x % 2 == 0 || cell->y % 2 == 0) continue; // Only cells are labeled, not lines
+      u8 cellIndex = (cell->x / 2) * 4 + cell->y / 2;
+      labeled |= 1 << cellIndex;
+      partition |= (u64)numRegions << (4 * cellIndex);
+    }
+    numRegions++;
+  }
+  puzzle->ClearGrid(true);
+  return partition;
+}
+
+u16 PuzzleDescriptor::RegionOf(u64 partition, u8 cell) {
+  u64 region = (partition >> (4 * cell)) & 0xF;
+  u16 cells = 0;
+  for (u8 i=0; i<16; i++) {
+    if (((partition >> (4 * i)) & 0xF) == region) cells |= 1 << i;
+  }
+  return cells;
+}
+
+u64 PuzzleDescriptor::ToPolyishCells(u16 cells) {
+  u64 polyishCells = 0;
+  for (u8 i=0; i<16; i++) {
+    if (cells & (1 << i)) polyishCells |= (u64)1 << ((i / 4) * 8 + i % 4);
+  }
+  return polyishCells;
+}
+
+SolutionWriter::SolutionWriter(const string& name, u8 startX, u8 startY, s64 resumeAt, int seedsPerChunk, u8 version)
+  : _startX(startX), _startY(startY), _seedsPerChunk(seedsPerChunk), _version(version) {
+  assert(_version >= 2 && _version <= SolutionReader::VERSION);
+  if (resumeAt == -1) {
+    _file = new FileWriter(name);
+    _file->WriteInt(SolutionReader::MAGIC | _version << 24);
+    _file->Write(&_startX, 1);
+    _file->Write(&_startY, 1);
+    _offset = sizeof(u32) + 2;
+    return;
+  }
+
+  // Check that the existing file matches the checkpoint before cutting it off. If it doesn't (e.g. it is missing, from
+  // another version, or the checkpoint doesn't land between two chunks), leave it alone, and report Failed().
+  // These are runtime checks rather than asserts, since they're about the files on disk, not about the code.
+  { // The existing file has to be closed before we can open it for writing (at least on Windows).
+    File existing(name);
+    u8 header[sizeof(u32) + 2];
+    if (existing.Size() < (u64)resumeAt || existing.ReadAt(0, header, sizeof(header)) != sizeof(header)) return;
+    u32 magic;
+    memcpy(&magic, header, sizeof(magic));
+    // Only files in the current version can be continued.
+    if (_version != SolutionReader::VERSION || magic != (SolutionReader::MAGIC | _version << 24)) return;
+    _startX = header[4];
+    _startY = header[5];
+
+    // Walk the chunk headers, and read the first seed of each chunk (which is written relative to 0).
+    const int chunkHeaderSize = sizeof(u32) + sizeof(u32) + 1;
+    u64 chunkOffset = sizeof(header);
+    while (chunkOffset < (u64)resumeAt) {
+      u8 chunkHeader[chunkHeaderSize + 10] = {}; // The header, then (up to) a varint
+      int size = existing.ReadAt(chunkOffset, chunkHeader, sizeof(chunkHeader));
+      u32 numSeeds, payloadSize;
+      memcpy(&numSeeds, chunkHeader, sizeof(numSeeds));
+      memcpy(&payloadSize, chunkHeader + sizeof(u32), sizeof(payloadSize));
+      if (size <= chunkHeaderSize || numSeeds == 0 || payloadSize > (u64)resumeAt - chunkOffset - chunkHeaderSize) {
+        _index.clear();
+        return;
+      }
+      const u8* position = chunkHeader + chunkHeaderSize;
+      MemorySource source = {position};
+      _index.emplace_back((u32)ReadVarint(source), chunkOffset);
+      chunkOffset += chunkHeaderSize + payloadSize;
+    }
+    if (chunkOffset != (u64)resumeAt) {
+      _index.clear();
+      return;
+    }
+  }
+  _file = new FileWriter(name, resumeAt);
+  _offset = resumeAt;
+}
+
+SolutionWriter::~SolutionWriter() {
+  if (_file == nullptr) return; // We couldn't resume, so the file was left alone.
+  if (_numSeeds > 0) WriteChunk();
+  if (_version < 3) { // No chunks, so no index either
+    delete _file;
+    return;
+  }
+  _file->WriteInt(0); // End of the chunks
+  u64 indexOffset = _offset + sizeof(u32);
+  for (const auto& [firstSeed, offset] : _index) {
+    _file->WriteInt(firstSeed);
+    _file->Write(&offset, sizeof(offset));
+  }
+  _file->Write(&indexOffset, sizeof(indexOffset));
+  _file->WriteInt((u32)_index.size());
+  _file->WriteInt(SolutionReader::INDEX_MAGIC);
+  delete _file;
+}
+
+void SolutionWriter::Write(u32 seed, const Vector<Path>& solutions, Puzzle* puzzle) {
+  PuzzleDescriptor descriptor = PuzzleDescriptor::Describe(puzzle);
+  std::vector<u64> partitions;
+  for (const Path& solution : solutions) partitions.push_back(PuzzleDescriptor::Partition(puzzle, solution));
+  Write(seed, solutions, descriptor, partitions);
+}
+
+void SolutionWriter::Write(u32 seed, const Vector<Path>& solutions, const PuzzleDescriptor& descriptor, const std::vector<u64>& partitions) {
+  if (_numSeeds == 0 && _version >= 3) {
+    _index.emplace_back(seed, _offset);
+    _previousSeed = 0;
+  }
+  assert(seed >= _previousSeed);
+  WriteVarint(seed - _previousSeed);
+  _previousSeed = seed;
+  WriteVarint(solutions.Size());
+  if (_version >= 4) {
+    WriteBytes(descriptor.stars, 2);
+    WriteBytes(descriptor.gaps, 5);
+    _chunk.push_back(descriptor.polyCells[0] | descriptor.polyCells[1] << 4);
+    WriteBytes(descriptor.polyshapes[0], 2);
+    WriteBytes(descriptor.polyshapes[1], 2);
+  }
+
+  assert(partitions.size() == (size_t)solutions.Size());
+  for (int k=0; k<solutions.Size(); k++) {
+    const Path& solution = solutions[k];
+    assert(solution[0] == _startX && solution[1] == _startY);
+    int numMoves = solution.Size() - 3; // Start x, start y, and PATH_NONE
+    WriteVarint(numMoves);
+
+    for (int i=0; i<numMoves; i+=4) {
+      u8 byte = 0;
+      for (int j=0; j<4 && i+j < numMoves; j++) byte |= (solution[2 + i + j] - 1) << (2 * j);
+      _chunk.push_back(byte);
+    }
+    if (_version >= 4) WriteBytes(partitions[k], sizeof(u64));
+  }
+
+  if (++_numSeeds == _seedsPerChunk) WriteChunk();
+}
+
+bool SolutionWriter::Checkpoint(u64& offset) {
+  if (_numSeeds > 0) WriteChunk();
+  if (_file == nullptr || !_file->Sync()) return false;
+  assert(_file->Offset() == _offset);
+  offset = _offset;
+  return true;
+}
+
+void SolutionWriter::WriteVarint(u64 value) {
+  while (value >= 0x80) {
+    _chunk.push_back((u8)value | 0x80);
+    value >>= 7;
+  }
+  _chunk.push_back((u8)value);
+}
+
+void SolutionWriter::WriteBytes(u64 value, int numBytes) {
+  for (int i=0; i<numBytes; i++) _chunk.push_back((u8)(value >> (8 * i)));
+}
+
+void SolutionWriter::WriteChunk() {
+  if (_file == nullptr) { // We couldn't resume, so there is nowhere to write to.
+    _chunk.clear();
+    _numSeeds = 0;
+    return;
+  }
+  if (_version >= 3) {
+    _file->WriteInt(_numSeeds);
+    _file->WriteInt((u32)_chunk.size());
+    _file->Write(&SolutionReader::ENCODING_RAW, 1);
+    _offset += sizeof(u32) + sizeof(u32) + 1;
+  }
+  _file->Write(_chunk.data(), (int)_chunk.size());
+  _offset += _chunk.size();
+  _chunk.clear();
+  _numSeeds = 0;
+}
+
+SolutionReader::SolutionReader(File& file) : _file(file) {
+  if (_file.Done()) return;
+  if (_file.Peek(0) == 'W' && _file.Peek(1) == 'R' && _file.Peek(2) == 'N' && (_file.Peek(3) & 0x80)) {
+    _version = _file.GetInt() >> 24 & 0x7F;
+    assert(_version >= 2 && _version <= VERSION);
+    _startX = _file.Get();
+    _startY = _file.Get();
+  }
+}
+
+bool SolutionReader::NextSeed(u32& seed, u32& numSolutions) {
+  if (_done || _file.Done()) return false;
+  if (_version == 1) {
+    seed = _file.GetInt();
+    numSolutions = _file.GetInt();
+    return true;
+  }
+
+  // Check that the records use up exactly the payload. If not, the seed count (or the payload size) is wrong.
+  if (_version >= 3 && (_seedsLeft > 0 ? _file.Offset() >= _chunkEnd : _chunkEnd != 0 && _file.Offset() != _chunkEnd)) {
+    _failed = true;
+    _done = true;
+    return false;
+  }
+  if (_version >= 3 && _seedsLeft == 0) { // Start of a chunk
+    // If thrd was stopped while writing, the file can end partway through a chunk. Only read whole chunks.
+    if (_file.Size() - _file.Offset() < sizeof(u32) + sizeof(u32) + 1) {
+      _done = true;
+      return false;
+    }
+    _seedsLeft = _file.GetInt();
+    if (_seedsLeft == 0) { // End of the chunks. The rest of the file is the index.
+      _done = true;
+      return false;
+    }
+    u32 payloadSize = _file.GetInt();
+    u8 encoding = _file.Get();
+    assert(encoding == ENCODING_RAW);
+    (void)encoding;
+    if (payloadSize > _file.Size() - _file.Offset()) {
+      _done = true;
+      return false;
+    }
+    _chunkEnd = _file.Offset() + payloadSize;
+    _previousSeed = 0;
+  }
+  if (_version >= 3) _seedsLeft--;
+
+  ReadSeed(_file, _version, _previousSeed, seed, numSolutions, _descriptor);
+  return true;
+}
+
+void SolutionReader::NextSolution(Path& path, u64* partition) {
+  if (_version != 1) {
+    ReadSolution(_file, _version, _startX, _startY, path, partition);
+    return;
+  }
+
+  path.Resize(0);
+  path.Push(_file.Get());
+  path.Push(_file.Get());
+  while (true) {
+    u8 dir = _file.Get();
+    path.Push(dir);
+    if (dir == PATH_NONE) break;
+  }
+}
+
+bool SolutionChunk::NextSeed(u32& seed, u32& numSolutions) {
+  const u8* end = _data.data() + _data.size();
+  // Same as SolutionReader, the records have to use up exactly the payload.
+  if (_seedsLeft > 0 ? _position >= end : _position != end) _failed = true;
+  if (_seedsLeft == 0 || _failed) return false;
+  _seedsLeft--;
+  MemorySource source = {_position};
+  ReadSeed(source, _version, _previousSeed, seed, numSolutions, _descriptor);
+  return true;
+}
+
+void SolutionChunk::NextSolution(Path& path, u64* partition) {
+  MemorySource source = {_position};
+  ReadSolution(source, _version, _startX, _startY, path, partition);
+}
+
+SolutionIndex::SolutionIndex(File& file) : _file(file) {
+  u8 header[sizeof(u32) + 2];
+  if (_file.ReadAt(0, header, sizeof(header)) != sizeof(header)) return;
+  u32 magic;
+  memcpy(&magic, header, sizeof(magic));
+  _version = header[3] & 0x7F;
+  if ((magic & 0x80FF'FFFF) != SolutionReader::MAGIC || _version < 3 || _version > SolutionReader::VERSION) return;
+  _startX = header[4];
+  _startY = header[5];
+
+  u8 footer[sizeof(u64) + sizeof(u32) + sizeof(u32)];
+  if (_file.Size() < sizeof(header) + sizeof(footer)) return;
+  if (_file.ReadAt(_file.Size() - sizeof(footer), footer, sizeof(footer)) != sizeof(footer)) return;
+  u64 indexOffset;
+  u32 numChunks;
+  memcpy(&indexOffset, footer, sizeof(indexOffset));
+  memcpy(&numChunks, footer + sizeof(u64), sizeof(numChunks));
+  memcpy(&magic, footer + sizeof(u64) + sizeof(u32), sizeof(magic));
+  if (magic != SolutionReader::INDEX_MAGIC) return; // No index, the writer was probably stopped early.
+
+  const int entrySize = sizeof(u32) + sizeof(u64);
+  vector<u8> entries((size_t)numChunks * entrySize);
+  if (_file.ReadAt(indexOffset, entries.data(), (int)entries.size()) != (int)entries.size()) return;
+  _index.resize(numChunks);
+  for (u32 i=0; i<numChunks; i++) {
+    memcpy(&_index[i].first, &entries[i * entrySize], sizeof(u32));
+    memcpy(&_index[i].second, &entries[i * entrySize + sizeof(u32)], sizeof(u64));
+  }
+}
+
+int SolutionIndex::FindChunk(u32 seed) const {
+  // The last chunk which starts at or before |seed|
+  auto it = upper_bound(_index.begin(), _index.end(), seed, [](u32 seed, const pair<u32, u64>& entry) { return seed < entry.first; });
+  return (int)(it - _index.begin()) - 1;
+}
+
+bool SolutionIndex::ReadChunk(int index, SolutionChunk& chunk) const {
+  u8 header[sizeof(u32) + sizeof(u32) + 1];
+  u64 offset = _index[index].second;
+  if (_file.ReadAt(offset, header, sizeof(header)) != sizeof(header)) return false;
+  u32 numSeeds, payloadSize;
+  memcpy(&numSeeds, header, sizeof(numSeeds));
+  memcpy(&payloadSize, header + sizeof(u32), sizeof(payloadSize));
+  if (header[8] != SolutionReader::ENCODING_RAW) return false;
+
+  chunk._data.resize(payloadSize);
+  if (_file.ReadAt(offset + sizeof(header), chunk._data.data(), (int)payloadSize) != (int)payloadSize) return false;
+  chunk._position = chunk._data.data();
+  chunk._failed = false;
+  chunk._seedsLeft = numSeeds;
+  chunk._previousSeed = 0;
+  chunk._version = _version;
+  chunk._startX = _startX;
+  chunk._startY = _startY;
+  return true;
+}
+
+bool SolutionIndex::Find(u32 seed, Vector<Path>& solutions) const {
+  int index = FindChunk(seed);
+  SolutionChunk chunk;
+  if (index < 0 || !ReadChunk(index, chunk)) return false;
+
+  u32 chunkSeed, numSolutions;
+  Path path;
+  while (chunk.NextSeed(chunkSeed, numSolutions)) {
+    if (chunkSeed > seed) return false; // Seeds are in order, so we've passed it.
+    for (u32 i=0; i<numSolutions; i++) {
+      chunk.NextSolution(path);
+      if (chunkSeed == seed) solutions.Emplace(path.Copy());
+    }
+    if (chunkSeed == seed) return true;
+  }
+  return false;
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include "forward.h"
+#include "File.h"
+#include <vector>
+
+// Reads and writes the thread_N_good.dat files, which hold a record for each solvable seed: the seed, then its solutions.
+// v1 (the original format): u32 seed, u32 number of solutions, then each solution exactly as Solver::Solve returns it
+//   (start x, start y, one byte per direction, PATH_NONE).
+// v2: A header (MAGIC | 2 << 24, then the start x and y), then for each record:
+//   - The seed, as a varint of the difference from the previous seed (seeds only go up). Each thread's seeds come in blocks of
+//     consecutive seeds, so this is almost always one byte.
+//   - The number of solutions, as a varint.
+//   - For each solution, the number of moves as a varint, then the moves packed 4 per byte (low bits first),
+//     as PATH_LEFT - 1 .. PATH_BOTTOM - 1. Every solution starts at the start point from the header.
+// v3: The same header (with version 3) and records, but grouped into chunks which can each be decoded on their own:
+//   - Each chunk is a u32 number of seeds, a u32 payload size, a u8 encoding (ENCODING_RAW), then the payload (the records).
+//     The seed differences restart from 0 in each chunk.
+//   - After the last chunk, a u32 0 (an empty chunk), then the index: a u32 first seed and u64 offset for each chunk,
+//     and finally a u64 offset of the index, u32 number of chunks, and u32 INDEX_MAGIC.
+//   A file without an index (e.g. if thrd was stopped) can still be read from the start, just not searched.
+// v4: The same as v3, but each record also describes the puzzle (see PuzzleDescriptor), so that it doesn't need to be
+//   regenerated to analyze the solutions. After the number of solutions: the stars (u16), the gaps (5 bytes), the poly
+//   cells (one byte, first cell in the low bits), then the two polyshapes (u16 each). After each solution's moves,
+//   its partition (u64).
+// Since seeds are at most 0x7FFF'FFFE, a v1 file can never start with MAGIC (which has the high bit set).
+// Everything that the analysis passes (e.g. "good") need to know about a 4x4 polyomino puzzle.
+// Cells are numbered column by column, the same order that "good" looks for polyominos in: cell (x, y) is (x / 2) * 4 + y / 2.
+struct PuzzleDescriptor {
+  u16 stars = 0; // One bit per cell
+  u64 gaps = 0;  // One bit per edge, numbered column by column (40 in all)
+  u8 polyCells[2] = {};
+  u16 polyshapes[2] = {};
+
+  // Describes |puzzle|, which must be a 4x4 with exactly two polyominos (e.g. from Random::GeneratePolyominos).
+  static PuzzleDescriptor Describe(Puzzle* puzzle);
+  // Which region each cell is in, after |solution| is traced on |puzzle|. 4 bits per cell, and the regions are
+  // numbered in the order they are found (so the first cell is always in region 0). This clears the lines on |puzzle|.
+  static u64 Partition(Puzzle* puzzle, const Path& solution);
+  // The cells in the same region as |cell|, one bit per cell.
+  static u16 RegionOf(u64 partition, u8 cell);
+  // Converts a mask of cells (as above) into the mask that Puzzle::GetPolyish expects.
+  static u64 ToPolyishCells(u16 cells);
+};
+
+class SolutionReader {
+public:
+  // Reads the header (if any), to find out which version |file| is.
+  SolutionReader(File& file);
+  // Reads the next record's seed and number of solutions. Returns false at the end of the file, or at a chunk which
+  // was cut short (so that a file from a thrd run which was stopped can still be read up to there).
+  bool NextSeed(u32& seed, u32& numSolutions);
+  // Reads the next solution of the current record into |path|, in the same format as Solver::Solve.
+  // If the file has descriptors, also reads the solution's partition (see PuzzleDescriptor::Partition).
+  void NextSolution(Path& path, u64* partition = nullptr);
+  u8 Version() const { return _version; }
+  bool HasDescriptors() const { return _version >= 4; }
+  // The current record's puzzle. Only valid if HasDescriptors().
+  const PuzzleDescriptor& Descriptor() const { return _descriptor; }
+  // True if NextSeed stopped because a chunk's seed count didn't match its payload (i.e. the file is corrupt),
+  // rather than at the end of the file.
+  bool Failed() const { return _failed; }
+
+  static constexpr u32 MAGIC = 0x8000'0000 | ('N' << 16) | ('R' << 8) | 'W'; // "WRN", then 0x80 | version
+  static constexpr u8 VERSION = 4; // The version which SolutionWriter writes
+  static constexpr u32 INDEX_MAGIC = ('X' << 24) | ('N' << 16) | ('R' << 8) | 'W'; // "WRNX"
+  static constexpr u8 ENCODING_RAW = 0; // Chunk payloads are stored as-is. Other values are reserved for compression.
+
+private:
+  File& _file;
+  u8 _version = 1;
+  u8 _startX = 0;
+  u8 _startY = 0;
+  u32 _previousSeed = 0;
+  u32 _seedsLeft = 0; // In the current chunk (v3 and later)
+  u64 _chunkEnd = 0;  // Offset of the end of the current chunk's payload
+  bool _done = false;
+  bool _failed = false;
+  PuzzleDescriptor _descriptor;
+};
+
+class SolutionWriter {
+public:
+  // Creates |name| and writes the header. Every solution passed to Write must start at (startX, startY).
+  // To continue a file from a checkpoint instead, pass the offset from Checkpoint() as |resumeAt|. The file is cut off
+  // there, and the chunks before it are read back to rebuild the index.
+  // |version| can be lowered to write one of the older formats (for testing the readers); those can't be continued.
+  SolutionWriter(const std::string& name, u8 startX, u8 startY, s64 resumeAt = -1, int seedsPerChunk = SEEDS_PER_CHUNK,
+                 u8 version = SolutionReader::VERSION);
+  // Writes the last chunk and the index, and closes the file.
+  ~SolutionWriter();
+  DELETE_RO3(SolutionWriter);
+
+  // Seeds must be written in increasing order, so that the index can be searched.
+  // |puzzle| is the puzzle that |solutions| solve, which is recorded as a PuzzleDescriptor.
+  void Write(u32 seed, const Vector<Path>& solutions, Puzzle* puzzle);
+  // The same, for callers which already have the descriptor and the partition of each solution.
+  void Write(u32 seed, const Vector<Path>& solutions, const PuzzleDescriptor& descriptor, const std::vector<u64>& partitions);
+  // Ends the current chunk early, and waits for everything written so far to reach the disk (see FileWriter::Sync).
+  // Sets |offset| to the size of the file at this point, which is where to resume from. Returns false if the file could
+  // not be written, in which case |offset| must not be used.
+  bool Checkpoint(u64& offset);
+  // True if the file could not be resumed (see the constructor), opened, or written (see FileWriter::Failed).
+  bool Failed() const { return _file == nullptr || _file->Failed(); }
+
+  static constexpr int SEEDS_PER_CHUNK = 4096;
+
+private:
+  void WriteVarint(u64 value);
+  void WriteBytes(u64 value, int numBytes); // Little-endian
+  void WriteChunk();
+
+  FileWriter* _file = nullptr;
+  u8 _startX;
+  u8 _startY;
+  int _seedsPerChunk;
+  u8 _version;
+  u32 _previousSeed = 0;
+  std::vector<u8> _chunk; // The payload of the current chunk
+  int _numSeeds = 0;      // In the current chunk
+  u64 _offset = 0;        // Of the current chunk, in the file
+  std::vector<std::pair<u32, u64>> _index; // First seed and offset of each chunk
+};
+
+// One chunk of a v3 (or later) file, read into memory. Chunks are independent, so several threads can decode different chunks at once (see "good").
+class SolutionChunk {
+public:
+  // Same as SolutionReader.
+  bool NextSeed(u32& seed, u32& numSolutions);
+  void NextSolution(Path& path, u64* partition = nullptr);
+  bool HasDescriptors() const { return _version >= 4; }
+  const PuzzleDescriptor& Descriptor() const { return _descriptor; }
+  bool Failed() const { return _failed; }
+
+private:
+  friend class SolutionIndex;
+  std::vector<u8> _data;
+  const u8* _position = nullptr;
+  bool _failed = false;
+  u32 _seedsLeft = 0;
+  u32 _previousSeed = 0;
+  u8 _version = 0;
+  u8 _startX = 0;
+  u8 _startY = 0;
+  PuzzleDescriptor _descriptor;
+};
+
+// Random access to a v3 (or later) file, using the index at the end of the file.
+class SolutionIndex {
+public:
+  // Reads the header and the index. If |file| has no index (or is older than v3), NumChunks() is 0.
+  SolutionIndex(File& file);
+
+  int NumChunks() const { return (int)_index.size(); }
+  // Returns the chunk which would contain |seed|, or -1 if it is before the first chunk.
+  int FindChunk(u32 seed) const;
+  // Reads chunk |index| into |chunk|. Safe to call from several threads at once. Returns false if the chunk could not be read.
+  bool ReadChunk(int index, SolutionChunk& chunk) const;
+  // Reads the solutions to |seed| into |solutions|. Returns false if |seed| is not in the file (i.e. it has no solutions).
+  bool Find(u32 seed, Vector<Path>& solutions) const;
+
+private:
+  File& _file;
+  u8 _version = 0;
+  u8 _startX = 0;
+  u8 _startY = 0;
+  std::vector<std::pair<u32, u64>> _index;
+};
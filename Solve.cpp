@@ -1,4 +1,65 @@
 #include "stdafx.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+thread_local SolverStats SolverStats::_current;
+
+SolverStats& SolverStats::operator+=(const SolverStats& other) {
+  nodes += other.nodes;
+  gapRejections += other.gapRejections;
+  prunes += other.prunes;
+  endpointValidations += other.endpointValidations;
+  regionsComputed += other.regionsComputed;
+  polyFits += other.polyFits;
+  placements += other.placements;
+  return *this;
+}
+
+// Subtrees deeper than this are always solved by the thread which found them, since the cost of copying out the task
+// outweighs the (small) amount of work left in them.
+constexpr int MAX_SPLIT_DEPTH = 24;
+
+struct ParallelState {
+  // Each thread owns a queue of tasks (path prefixes). The owner works from the back (depth-first),
+  // and idle threads steal from the front, which holds the shallowest (i.e. largest) subtrees.
+  struct TaskQueue {
+    std::mutex lock;
+    std::deque<Path> tasks;
+  };
+  std::vector<TaskQueue> queues;
+  std::atomic<int> pendingTasks = 0; // Tasks which have been queued but not yet finished
+  std::atomic<int> idleThreads = 0;
+
+  ParallelState(int numThreads) : queues(numThreads) {}
+
+  void Push(int i, Path&& task) {
+    pendingTasks++;
+    std::lock_guard<std::mutex> guard(queues[i].lock);
+    queues[i].tasks.emplace_back(std::move(task));
+  }
+
+  bool Pop(int i, Path& task) {
+    for (int j=0; j<queues.size(); j++) {
+      TaskQueue& queue = queues[(i + j) % queues.size()];
+      std::lock_guard<std::mutex> guard(queue.lock);
+      if (queue.tasks.empty()) continue;
+      if (j == 0) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+      return true;
+    }
+    return false;
+  }
+};
 
 Solver::Solver() {
   path = new Path();
@@ -8,15 +69,255 @@ Solver::Solver() {
 Solver::~Solver() {
   delete path;
   delete validator;
+  if (deadCells) delete deadCells;
+  if (endDistance) delete endDistance;
+  if (moveTable) delete moveTable;
 }
 
 Vector<Path> Solver::Solve(Puzzle* puzzle_, int maxSolutions) {
   puzzle = puzzle_;
-  path->Ensure(puzzle->_width * puzzle->_height); // A little overkill but whatever.
-  path->Resize(0);
+  Vector<Cell*> startPoints(puzzle->_width);
+  u8 numEndpoints = 0;
+
+  // Some reasonable default data, which will avoid crashes during the solveLoop.
+  // var earlyExitData = [false, {"isEdge": false}, {"isEdge": false}]
+  if (maxSolutions > 0) MAX_SOLUTIONS = maxSolutions;
+  Vector<Path> solutionPaths(MAX_SOLUTIONS);
+  Trace::Record(TraceEvent::SolveStart, puzzle->_width, puzzle->_height);
+  if (!Prepare(startPoints, numEndpoints)) {
+    Trace::Record(TraceEvent::SolveEnd, 0);
+    return solutionPaths;
+  }
+  Trace::Record(TraceEvent::Prepare, startPoints.Size(), numEndpoints);
 
+  for (Cell* startPoint : startPoints) {
+    if (IsMirroredStart(startPoint)) continue;
+    // NOTE: This is subtly different from WitnessPuzzles, which starts the path with [[x, y]] instead of [x, y]!
+    path->UnsafePush(startPoint->x);
+    path->UnsafePush(startPoint->y);
+    puzzle->_startPoint = startPoint;
+    SolveLoop(startPoint->x, startPoint->y, solutionPaths, numEndpoints);
+    path->Resize(0); // Otherwise, solutions from the next start point would begin with this start point's coordinates.
+  }
+
+  Trace::Record(TraceEvent::SolveEnd, solutionPaths.Size());
+  if (!mirrorSolutions) return solutionPaths;
+  // The mirrored solutions were found alongside the originals, so put them back in order.
+  std::vector<Path> allSolutions;
+  for (Path& solution : solutionPaths) allSolutions.emplace_back(std::move(solution));
+  return SortSolutions(allSolutions);
+}
+
+Vector<Path> Solver::SolveParallel(Puzzle* puzzle_, int maxSolutions, int numThreads) {
+  if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+  if (numThreads <= 1) return Solve(puzzle_, maxSolutions);
+
+  puzzle = puzzle_;
   Vector<Cell*> startPoints(puzzle->_width);
   u8 numEndpoints = 0;
+  if (maxSolutions > 0) MAX_SOLUTIONS = maxSolutions;
+  if (!Prepare(startPoints, numEndpoints, false)) return Vector<Path>(MAX_SOLUTIONS);
+
+  // Seed the first thread with the root of each search tree. Once the other threads go idle, it will start splitting
+  // off subtrees for them to steal (see SolveLoop), and so on until everyone is busy.
+  ParallelState state(numThreads);
+  for (Cell* startPoint : startPoints) {
+    if (IsMirroredStart(startPoint)) continue;
+    Path task;
+    task.Push(startPoint->x);
+    task.Push(startPoint->y);
+    state.Push(0, std::move(task));
+  }
+
+  std::vector<std::vector<Path>> threadSolutions(numThreads);
+  std::vector<SolverStats> threadStats(numThreads); // The workers' counters are thread_local, so they die with the threads.
+  std::vector<std::thread> threads;
+  for (int i=0; i<numThreads; i++) {
+    threads.emplace_back([&](int i) {
+      // Each thread draws lines on its own copy of the grid, so that the DFS state doesn't collide.
+      Puzzle* copy = puzzle_->Copy();
+      Solver solver;
+      solver.puzzle = copy;
+      solver.MAX_SOLUTIONS = MAX_SOLUTIONS; // Leave the default move order, see the comment in Solve.h
+      solver.parallel = &state;
+      solver.workerIndex = i;
+      Vector<Cell*> copyStartPoints(copy->_width);
+      u8 copyNumEndpoints = 0;
+      solver.Prepare(copyStartPoints, copyNumEndpoints, false); // Cannot fail, since it succeeded on the original puzzle.
+
+      bool idle = false;
+      while (true) {
+        Path task;
+        if (!state.Pop(i, task)) {
+          if (!idle) state.idleThreads++;
+          idle = true;
+          if (state.pendingTasks == 0) break;
+          std::this_thread::yield();
+          continue;
+        }
+        if (idle) state.idleThreads--;
+        idle = false;
+
+        // Replay the task's prefix, then search the subtree below it.
+        // Each task keeps up to MAX_SOLUTIONS of its own (the first ones in DFS order), so that the first MAX_SOLUTIONS
+        // overall are guaranteed to be among them, regardless of which thread finishes first.
+        solver.prefix = &task;
+        solver.path->Resize(0);
+        solver.path->UnsafePush(task[0]);
+        solver.path->UnsafePush(task[1]);
+        copy->_startPoint = copy->GetCell(task[0], task[1]);
+        Vector<Path> taskSolutions(0);
+        solver.SolveLoop(task[0], task[1], taskSolutions, copyNumEndpoints);
+        for (Path& solution : taskSolutions) threadSolutions[i].emplace_back(std::move(solution));
+        state.pendingTasks--;
+      }
+      if (idle) state.idleThreads--;
+      threadStats[i] = SolverStats::Get();
+      delete copy;
+    }, i);
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (const SolverStats& stats : threadStats) SolverStats::Get() += stats;
+
+  std::vector<Path> allSolutions;
+  for (std::vector<Path>& solutions : threadSolutions) {
+    for (Path& solution : solutions) allSolutions.emplace_back(std::move(solution));
+  }
+  return SortSolutions(allSolutions);
+}
+
+Vector<Path> Solver::SolveBidirectional(Puzzle* puzzle_, int maxSolutions) {
+  puzzle = puzzle_;
+  Vector<Cell*> startPoints(puzzle->_width);
+  u8 numEndpoints = 0;
+  if (maxSolutions > 0) MAX_SOLUTIONS = maxSolutions;
+  if (!Prepare(startPoints, numEndpoints)) return Vector<Path>(MAX_SOLUTIONS);
+
+  // The diagram is built one edge at a time, merging partial paths which leave the same frontier state (which vertices
+  // are in use, and how the path fragments connect across the cut). Counting then works back from the endpoints,
+  // so a node only has a nonzero count if it can be both reached from a start and completed to an end.
+  // In other words, the enumeration never explores a dead end, and only needs to check the other symbols.
+  PathDiagram diagram(puzzle);
+  std::vector<Path> allSolutions;
+  diagram.Enumerate([&](const Path& candidate) {
+    TracePath(candidate, true);
+    SolverStats::Get().endpointValidations++;
+    if (validator->IsValid(*puzzle)) allSolutions.emplace_back(candidate.Copy());
+    TracePath(candidate, false);
+    return (int)allSolutions.size() < MAX_SOLUTIONS;
+  });
+  return SortSolutions(allSolutions);
+}
+
+Vector<Path> Solver::SortSolutions(std::vector<Path>& solutions) {
+  // The DFS explores directions in increasing order (PATH_LEFT < PATH_RIGHT < PATH_TOP < PATH_BOTTOM), and a solution
+  // which stops at an endpoint (PATH_NONE) comes before one which continues past it. So with MoveOrder::Fixed, sorting
+  // the paths puts them back into the order that Solve would have found them in.
+  // Note that this only keeps the first MAX_SOLUTIONS of the solutions it's given. If the search which found them
+  // stopped at MAX_SOLUTIONS, which solutions those are depends on the order that search visited them in.
+  std::sort(solutions.begin(), solutions.end(), [](const Path& a, const Path& b) {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+  });
+
+  Vector<Path> solutionPaths(MAX_SOLUTIONS);
+  for (Path& solution : solutions) {
+    if (solutionPaths.Size() >= MAX_SOLUTIONS) break;
+    solutionPaths.Emplace(std::move(solution));
+  }
+  return solutionPaths;
+}
+
+bool Solver::IsMirroredStart(Cell* startPoint) {
+  if (!mirrorSolutions) return false;
+  Cell* symCell = puzzle->GetSymmetricalCell(startPoint);
+  return symCell->x < startPoint->x || (symCell->x == startPoint->x && symCell->y < startPoint->y);
+}
+
+void Solver::AddMirrorSolution(Cell* endPoint, Vector<Path>& solutionPaths) {
+  // Swapping the colors (and the start and end points) is exactly the state the DFS would reach by tracing the reflection
+  // of our path from the reflected start point.
+  Cell* startPoint = puzzle->_startPoint;
+  puzzle->_startPoint = puzzle->GetSymmetricalCell(startPoint);
+  puzzle->_endPoint = puzzle->GetSymmetricalCell(endPoint);
+  SwapLineColors();
+  SolverStats::Get().endpointValidations++;
+  if (validator->IsValid(*puzzle)) {
+    Path mirror = path->Copy();
+    auto [x, y] = puzzle->GetSymmetricalPos(mirror[0], mirror[1]);
+    mirror[0] = x;
+    mirror[1] = y;
+    for (int i=2; i<mirror.Size(); i++) {
+      u8& dir = mirror[i];
+      if (puzzle->_symmetry & SYM_X) {
+        if (dir == PATH_LEFT)       dir = PATH_RIGHT;
+        else if (dir == PATH_RIGHT) dir = PATH_LEFT;
+      }
+      if (puzzle->_symmetry & SYM_Y) {
+        if (dir == PATH_TOP)         dir = PATH_BOTTOM;
+        else if (dir == PATH_BOTTOM) dir = PATH_TOP;
+      }
+    }
+    solutionPaths.Emplace(std::move(mirror));
+  }
+  SwapLineColors();
+  puzzle->_startPoint = startPoint;
+  puzzle->_endPoint = endPoint;
+}
+
+void Solver::SwapLineColors() {
+  // Only the cells on the path (and their reflections) have lines, so there's no need to scan the whole grid.
+  Cell* cell = puzzle->GetCell(path->At(0), path->At(1));
+  for (int i=2; ; i++) {
+    Cell* symCell = puzzle->GetSymmetricalCell(cell);
+    cell->line = (cell->line == Line::Blue) ? Line::Yellow : Line::Blue;
+    symCell->line = (symCell->line == Line::Blue) ? Line::Yellow : Line::Blue;
+
+    u8 dir = path->At(i);
+    if (dir == PATH_NONE) break;
+    else if (dir == PATH_LEFT)   cell = puzzle->GetCell(cell->x - 1, cell->y);
+    else if (dir == PATH_RIGHT)  cell = puzzle->GetCell(cell->x + 1, cell->y);
+    else if (dir == PATH_TOP)    cell = puzzle->GetCell(cell->x, cell->y - 1);
+    else if (dir == PATH_BOTTOM) cell = puzzle->GetCell(cell->x, cell->y + 1);
+  }
+}
+
+bool Solver::HasSymmetricalEndpoints() {
+  for (u8 x=0; x<puzzle->_width; x++) {
+    for (u8 y=0; y<puzzle->_height; y++) {
+      Cell* cell = &puzzle->_grid->Get(x, y);
+      if (!cell->start && cell->end == End::None) continue;
+      Cell* symCell = puzzle->GetSymmetricalCell(cell);
+      if (symCell->start != cell->start) return false;
+      if ((symCell->end == End::None) != (cell->end == End::None)) return false;
+    }
+  }
+  return true;
+}
+
+void Solver::TracePath(const Path& solution, bool draw) {
+  Cell* cell = puzzle->GetCell(solution[0], solution[1]);
+  puzzle->_startPoint = cell;
+  for (int i=2; ; i++) {
+    if (puzzle->_symmetry == SYM_NONE) {
+      cell->line = draw ? Line::Black : Line::None;
+    } else {
+      cell->line = draw ? Line::Blue : Line::None;
+      puzzle->GetSymmetricalCell(cell)->line = draw ? Line::Yellow : Line::None;
+    }
+
+    u8 dir = solution[i];
+    if (dir == PATH_NONE) break;
+    else if (dir == PATH_LEFT)   cell = puzzle->GetCell(cell->x - 1, cell->y);
+    else if (dir == PATH_RIGHT)  cell = puzzle->GetCell(cell->x + 1, cell->y);
+    else if (dir == PATH_TOP)    cell = puzzle->GetCell(cell->x, cell->y - 1);
+    else if (dir == PATH_BOTTOM) cell = puzzle->GetCell(cell->x, cell->y + 1);
+  }
+  puzzle->_endPoint = cell;
+}
+
+bool Solver::Prepare(Vector<Cell*>& startPoints, u8& numEndpoints, bool allowMirror) {
+  path->Ensure(puzzle->_width * puzzle->_height); // A little overkill but whatever.
+  path->Resize(0);
 
   puzzle->_hasNegations = false;
   puzzle->_hasPolyominos = false;
@@ -33,10 +334,43 @@ Vector<Path> Solver::Solve(Puzzle* puzzle_, int maxSolutions) {
     }
   }
 
-  // Some reasonable default data, which will avoid crashes during the solveLoop.
-  // var earlyExitData = [false, {"isEdge": false}, {"isEdge": false}]
-  if (maxSolutions > 0) MAX_SOLUTIONS = maxSolutions;
-  Vector<Path> solutionPaths(MAX_SOLUTIONS);
+  // Many random puzzles are unsolvable for simple reasons: The cuts isolate the endpoint, or a dot is in a cul-de-sac.
+  // Check for those cases before starting the (expensive) DFS.
+  if (!PrePass(startPoints)) return false;
+
+  // The two lines of a symmetry puzzle are interchangeable: Tracing the reflection of a path from the reflected start point
+  // gives the same two lines, just with the colors swapped. So, if every start and end point has a reflection,
+  // we only need to search from one of each pair of start points, and then check both colorings of each path.
+  mirrorSolutions = allowMirror && puzzle->_symmetry != SYM_NONE && HasSymmetricalEndpoints();
+  if (!validator->StartPath(*puzzle, mirrorSolutions)) return false;
+
+  if (moveOrder != MoveOrder::Fixed) {
+    if (endDistance == nullptr) { // Cleared by PrePass when the grid size changes
+      endDistance = new NArray<u8>(deadWidth, deadHeight);
+      moveTable = new NArray<u16>(deadWidth, deadHeight);
+    }
+    ComputeDistances(endDistance);
+
+    if (moveOrder == MoveOrder::Dots) {
+      dotCells.clear();
+      for (u8 x=0; x<puzzle->_width; x++) {
+        for (u8 y=0; y<puzzle->_height; y++) {
+          Cell* cell = &puzzle->_grid->Get(x, y);
+          if (cell->dot != Dot::None && deadCells->Get(x, y) == 0) dotCells.push_back(cell);
+        }
+      }
+    } else if (moveOrder == MoveOrder::NearestEnd) {
+      for (u8 x=0; x<puzzle->_width; x++) {
+        for (u8 y=0; y<puzzle->_height; y++) {
+          u8 moves[4];
+          u8 numMoves = OrderMoves(x, y, moves);
+          u16 packed = 0;
+          for (s8 i=numMoves-1; i>=0; i--) packed = (packed << 4) | moves[i];
+          moveTable->Get(x, y) = packed;
+        }
+      }
+    }
+  }
 
   // Large pruning optimization -- Attempt to early exit once we cut out a region.
   // Inspired by https://github.com/Overv/TheWitnessSolver
@@ -63,19 +397,207 @@ Vector<Path> Solver::Solve(Puzzle* puzzle_, int maxSolutions) {
   // depend on the path through the entire puzzle
   // doPruning = (puzzle->_pillar == false);
   doPruning = false; // Sigh.
+  return true;
+}
+
+bool Solver::PrePass(const Vector<Cell*>& startPoints) {
+  if (deadCells == nullptr || deadWidth != puzzle->_width || deadHeight != puzzle->_height) {
+    if (deadCells) delete deadCells;
+    deadWidth = puzzle->_width;
+    deadHeight = puzzle->_height;
+    deadCells = new NArray<u8>(deadWidth, deadHeight);
+    if (endDistance) delete endDistance;
+    if (moveTable) delete moveTable;
+    endDistance = nullptr;
+    moveTable = nullptr;
+  }
+  deadCells->Fill((u8)1); // Every cell is dead until we show that the path can reach it.
 
+  // Step 1: BFS from the start point(s) to find all reachable cells.
+  Vector<Cell*> queue(puzzle->_width * puzzle->_height);
   for (Cell* startPoint : startPoints) {
-    // NOTE: This is subtly different from WitnessPuzzles, which starts the path with [[x, y]] instead of [x, y]!
-    path->UnsafePush(startPoint->x);
-    path->UnsafePush(startPoint->y);
-    puzzle->_startPoint = startPoint;
-    SolveLoop(startPoint->x, startPoint->y, solutionPaths, numEndpoints);
+    if (!IsTraversable(startPoint)) continue;
+    deadCells->Get(startPoint->x, startPoint->y) = 0;
+    queue.UnsafePush(startPoint);
+  }
+  for (int i=0; i<queue.Size(); i++) {
+    Cell* cell = queue[i];
+    Cell* neighbors[4] = {
+      puzzle->GetCell(cell->x - 1, cell->y),
+      puzzle->GetCell(cell->x + 1, cell->y),
+      puzzle->GetCell(cell->x, cell->y - 1),
+      puzzle->GetCell(cell->x, cell->y + 1),
+    };
+    for (Cell* neighbor : neighbors) {
+      if (!IsTraversable(neighbor)) continue;
+      u8& dead = deadCells->Get(neighbor->x, neighbor->y);
+      if (dead == 0) continue;
+      dead = 0;
+      queue.UnsafePush(neighbor);
+    }
   }
 
-  return solutionPaths;
+  // Step 2: Remove dead ends. Any cell which is not a start or an end needs two live neighbors, since the path has to
+  // enter and then exit it. Removing a cell may create a new dead end, so we re-check its neighbors.
+  while (!queue.Empty()) {
+    Cell* cell = queue.PopValue();
+    if (deadCells->Get(cell->x, cell->y) != 0) continue;
+    if (cell->start || cell->end != End::None) continue;
+
+    u8 liveNeighbors = 0;
+    Cell* neighbors[4] = {
+      puzzle->GetCell(cell->x - 1, cell->y),
+      puzzle->GetCell(cell->x + 1, cell->y),
+      puzzle->GetCell(cell->x, cell->y - 1),
+      puzzle->GetCell(cell->x, cell->y + 1),
+    };
+    for (Cell* neighbor : neighbors) {
+      if (neighbor != nullptr && deadCells->Get(neighbor->x, neighbor->y) == 0) liveNeighbors++;
+    }
+    if (liveNeighbors >= 2) continue;
+
+    deadCells->Get(cell->x, cell->y) = 1;
+    for (Cell* neighbor : neighbors) {
+      if (neighbor != nullptr && deadCells->Get(neighbor->x, neighbor->y) == 0) queue.Push(neighbor);
+    }
+  }
+
+  // Step 3: Check that all obligatory elements are still reachable.
+  bool canReachEnd = false;
+  for (u8 x=0; x<puzzle->_width; x++) {
+    for (u8 y=0; y<puzzle->_height; y++) {
+      Cell* cell = &puzzle->_grid->Get(x, y);
+      bool isDead = (deadCells->Get(x, y) != 0);
+      if (cell->end != End::None && !isDead) canReachEnd = true;
+      if (cell->dot != Dot::None && isDead) {
+        // Dots may also be covered by the reflected line, which means the reflection of the dot cell must be reachable.
+        if (puzzle->_symmetry != SYM_NONE) {
+          Cell* symCell = puzzle->GetSymmetricalCell(cell);
+          if (deadCells->Get(symCell->x, symCell->y) == 0) continue;
+        }
+        console.log("Dot at", x, y, "cannot be reached");
+        return false;
+      }
+    }
+  }
+  if (!canReachEnd) console.log("No endpoint can be reached");
+  return canReachEnd;
+}
+
+bool Solver::IsTraversable(Cell* cell) {
+  if (cell == nullptr || cell->type != Type::Line) return false;
+  if (cell->gap != Gap::None) return false;
+  if (puzzle->_symmetry != SYM_NONE) {
+    // The reflected line needs to be able to go here too (see the collision checks in SolveLoop).
+    Cell* symCell = puzzle->GetSymmetricalCell(cell);
+    if (puzzle->MatchesSymmetricalPos(cell->x, cell->y, symCell->x, symCell->y)) return false;
+    if (symCell->gap != Gap::None) return false;
+  }
+  return true;
+}
+
+void Solver::ComputeDistances(NArray<u8>* distance) {
+  distance->Fill((u8)0xFF);
+  Vector<Cell*> queue(puzzle->_width * puzzle->_height);
+  for (u8 x=0; x<puzzle->_width; x++) {
+    for (u8 y=0; y<puzzle->_height; y++) {
+      if (deadCells->Get(x, y) != 0) continue;
+      Cell* cell = &puzzle->_grid->Get(x, y);
+      if (cell->end == End::None) continue;
+      distance->Get(x, y) = 0;
+      queue.UnsafePush(cell);
+    }
+  }
+
+  // Breadth-first, so each cell is reached via its shortest path. GetCell takes care of wrapping around pillars.
+  for (int i=0; i<queue.Size(); i++) {
+    Cell* cell = queue[i];
+    u8 nextDistance = distance->Get(cell->x, cell->y);
+    if (nextDistance < 0xFE) nextDistance++;
+    Cell* neighbors[4] = {
+      puzzle->GetCell(cell->x - 1, cell->y),
+      puzzle->GetCell(cell->x + 1, cell->y),
+      puzzle->GetCell(cell->x, cell->y - 1),
+      puzzle->GetCell(cell->x, cell->y + 1),
+    };
+    for (Cell* neighbor : neighbors) {
+      if (neighbor == nullptr || deadCells->Get(neighbor->x, neighbor->y) != 0) continue;
+      u8& neighborDistance = distance->Get(neighbor->x, neighbor->y);
+      if (neighborDistance != 0xFF) continue;
+      neighborDistance = nextDistance;
+      queue.UnsafePush(neighbor);
+    }
+  }
+}
+
+u8 Solver::OrderMoves(s8 x, s8 y, u8 moves[4]) {
+  u8 numMoves = 0;
+  if (y%2 == 0) {
+    moves[numMoves++] = PATH_LEFT;
+    moves[numMoves++] = PATH_RIGHT;
+  }
+  if (x%2 == 0) {
+    moves[numMoves++] = PATH_TOP;
+    moves[numMoves++] = PATH_BOTTOM;
+  }
+  if (moveOrder == MoveOrder::Fixed) return numMoves;
+
+  u16 scores[4];
+  for (u8 i=0; i<numMoves; i++) {
+    if (moves[i] == PATH_LEFT)        scores[i] = MoveScore(puzzle->GetCell(x - 1, y));
+    else if (moves[i] == PATH_RIGHT)  scores[i] = MoveScore(puzzle->GetCell(x + 1, y));
+    else if (moves[i] == PATH_TOP)    scores[i] = MoveScore(puzzle->GetCell(x, y - 1));
+    else if (moves[i] == PATH_BOTTOM) scores[i] = MoveScore(puzzle->GetCell(x, y + 1));
+  }
+
+  // Insertion sort, which is stable, so ties are still broken in LRUD order.
+  for (u8 i=1; i<numMoves; i++) {
+    for (u8 j=i; j>0 && scores[j] < scores[j-1]; j--) {
+      std::swap(scores[j], scores[j-1]);
+      std::swap(moves[j], moves[j-1]);
+    }
+  }
+  return numMoves;
+}
+
+u16 Solver::MoveScore(Cell* cell) {
+  // Moves which SolveLoop will immediately reject go last. (They're cheap to reject, so we don't bother removing them.)
+  if (cell == nullptr || cell->line != Line::None || deadCells->Get(cell->x, cell->y) != 0) return 0xFFFF;
+
+  u8 distance = endDistance->Get(cell->x, cell->y);
+  if (moveOrder == MoveOrder::NearestEnd) return distance;
+  if (moveOrder == MoveOrder::Dots) {
+    // Head for the nearest dot which neither line has covered yet. This ignores walls, but it's only a tiebreak,
+    // and it's much cheaper than a flood fill on every step.
+    u8 dotDistance = 0xFF;
+    for (Cell* dot : dotCells) {
+      if (dot->line != Line::None) continue;
+      int dx = abs(dot->x - cell->x);
+      if (puzzle->_pillar) dx = min(dx, puzzle->_width - dx);
+      dotDistance = (u8)min(dx + abs(dot->y - cell->y), (int)dotDistance);
+    }
+    return (dotDistance << 8) | distance;
+  }
+
+  // MoveOrder::HugWalls: Count how many ways we could leave |cell|. Going into a cell with only one way out means
+  // we are following a wall (or our own line), rather than cutting the open area in half.
+  u8 openNeighbors = 0;
+  Cell* neighbors[4] = {
+    puzzle->GetCell(cell->x - 1, cell->y),
+    puzzle->GetCell(cell->x + 1, cell->y),
+    puzzle->GetCell(cell->x, cell->y - 1),
+    puzzle->GetCell(cell->x, cell->y + 1),
+  };
+  for (Cell* neighbor : neighbors) {
+    if (neighbor == nullptr || neighbor->line != Line::None) continue;
+    if (deadCells->Get(neighbor->x, neighbor->y) != 0) continue;
+    openNeighbors++;
+  }
+  return (openNeighbors << 8) | distance;
 }
 
 void Solver::TailRecurse(Cell* cell) {
+  validator->PopCell(*puzzle, cell);
   cell->line = Line::None;
   if (puzzle->_symmetry != SYM_NONE) {
     Cell* symCell = puzzle->GetSymmetricalCell(cell);
@@ -90,29 +612,56 @@ void Solver::SolveLoop(s8 x, s8 y, Vector<Path>& solutionPaths, u8 numEndpoints)
   // Check for collisions (outside, gap, self, other)
   Cell* cell = puzzle->GetCell(x, y);
   if (cell == nullptr || cell->type == Type::Null) return;
-  if (cell->gap != Gap::None) return;
+  SolverStats& stats = SolverStats::Get();
+  if (cell->gap != Gap::None) {
+    stats.gapRejections++;
+    return;
+  }
   if (cell->line != Line::None) return;
+  if (deadCells->Get(cell->x, cell->y) != 0) return; // Removed by the PrePass
+  stats.nodes++;
 
   if (puzzle->_symmetry == SYM_NONE) {
     cell->line = Line::Black;
   } else {
+    // The PrePass already removed cells which collide with their reflection, or whose reflection is a gap.
     Cell* symCell = puzzle->GetSymmetricalCell(cell);
-    if (puzzle->MatchesSymmetricalPos(x, y, symCell->x, symCell->y)) return; // Would collide with our reflection
-
-    if (symCell->gap != Gap::None) return;
-
     cell->line = Line::Blue;
     symCell->line = Line::Yellow;
   }
 
+  // Reject moves which make the puzzle impossible (e.g. too many triangle borders), rather than continuing
+  // to an endpoint and finding out there.
+  Cell* previous = nullptr;
+  if (path->Size() > 2) { // The first two entries are the start point
+    u8 dir = path->At(path->Size() - 1);
+    if (dir == PATH_LEFT)        previous = puzzle->GetCell(x + 1, y);
+    else if (dir == PATH_RIGHT)  previous = puzzle->GetCell(x - 1, y);
+    else if (dir == PATH_TOP)    previous = puzzle->GetCell(x, y + 1);
+    else if (dir == PATH_BOTTOM) previous = puzzle->GetCell(x, y - 1);
+  }
+  if (!validator->PushCell(*puzzle, cell, previous)) {
+    stats.prunes++;
+    TailRecurse(cell);
+    return;
+  }
+
   if (cell->end != End::None) {
-    path->UnsafePush(PATH_NONE);
-    puzzle->_endPoint = cell;
-    RegionData puzzleData = validator->Validate(*puzzle, true);
-    if (puzzleData.Valid()) {
-      solutionPaths.Emplace(path->Copy());
+    // When replaying a task's prefix, the task which split it off has already checked this endpoint.
+    bool isReplay = prefix != nullptr && prefix->Size() > 2 && path->Size() <= prefix->Size();
+    if (!isReplay) {
+      path->UnsafePush(PATH_NONE);
+      puzzle->_endPoint = cell;
+      if (validator->CouldBeValid(false)) {
+        stats.endpointValidations++;
+        if (validator->IsValid(*puzzle)) {
+          solutionPaths.Emplace(path->Copy());
+          Trace::Record(TraceEvent::Solution, solutionPaths.Size(), path->Size());
+        }
+      }
+      if (mirrorSolutions && validator->CouldBeValid(true)) AddMirrorSolution(cell, solutionPaths);
+      path->Pop();
     }
-    path->Pop();
 
     // If there are no further endpoints, tail recurse.
     // Otherwise, keep going -- we might be able to reach another endpoint.
@@ -136,8 +685,8 @@ void Solver::SolveLoop(s8 x, s8 y, Vector<Path>& solutionPaths, u8 numEndpoints)
       s8 floodY = earlyExitData.y2 + (earlyExitData.y1 - y);
       Region region = puzzle->GetRegion(floodX, floodY);
       if (!region.Empty()) {
-        RegionData regionData = validator->ValidateRegion(*puzzle, region, true);
-        if (!regionData.Valid()) {
+        if (!validator->IsRegionValid(*puzzle, region)) {
+          stats.prunes++;
           TailRecurse(cell);
           return;
         }
@@ -156,7 +705,41 @@ void Solver::SolveLoop(s8 x, s8 y, Vector<Path>& solutionPaths, u8 numEndpoints)
     }
   }
 
-  // Recursion order (LRUD) is optimized for BL->TR and mid-start puzzles
+  if (prefix != nullptr) {
+    if (path->Size() < prefix->Size()) {
+      // Still replaying the task's prefix (see SolveParallel), so only follow the next step.
+      Recurse(x, y, (*prefix)[path->Size()], solutionPaths, numEndpoints);
+      TailRecurse(cell);
+      return;
+    }
+
+    // If another thread is out of work, hand it this subtree instead of searching it ourselves.
+    // (Never at the end of our own prefix, or we would just keep handing the same task back and forth.)
+    if (path->Size() > prefix->Size() && path->Size() < MAX_SPLIT_DEPTH && parallel->idleThreads > 0) {
+      parallel->Push(workerIndex, path->Copy());
+      TailRecurse(cell);
+      return;
+    }
+  }
+
+  if (moveOrder == MoveOrder::HugWalls || moveOrder == MoveOrder::Dots) { // These depend on the path, see MoveScore
+    u8 moves[4];
+    u8 numMoves = OrderMoves(x, y, moves);
+    for (u8 i=0; i<numMoves; i++) {
+      Recurse(x, y, moves[i], solutionPaths, numEndpoints);
+    }
+    TailRecurse(cell);
+    return;
+  } else if (moveOrder == MoveOrder::NearestEnd) {
+    for (u16 moves = moveTable->Get(x, y); moves != 0; moves >>= 4) {
+      Recurse(x, y, moves & 0xF, solutionPaths, numEndpoints);
+    }
+    TailRecurse(cell);
+    return;
+  }
+
+  // Recursion order (LRUD) is optimized for BL->TR and mid-start puzzles.
+  // This is the same order as OrderMoves with MoveOrder::Fixed, unrolled since it's the hot path.
   if (y%2 == 0) {
     path->UnsafePush(PATH_LEFT);
     SolveLoop(x - 1, y, solutionPaths, numEndpoints);
@@ -179,3 +762,12 @@ void Solver::SolveLoop(s8 x, s8 y, Vector<Path>& solutionPaths, u8 numEndpoints)
 
   TailRecurse(cell);
 }
+
+void Solver::Recurse(s8 x, s8 y, u8 dir, Vector<Path>& solutionPaths, u8 numEndpoints) {
+  path->UnsafePush(dir);
+  if (dir == PATH_LEFT)        SolveLoop(x - 1, y, solutionPaths, numEndpoints);
+  else if (dir == PATH_RIGHT)  SolveLoop(x + 1, y, solutionPaths, numEndpoints);
+  else if (dir == PATH_TOP)    SolveLoop(x, y - 1, solutionPaths, numEndpoints);
+  else if (dir == PATH_BOTTOM) SolveLoop(x, y + 1, solutionPaths, numEndpoints);
+  path->Pop();
+}
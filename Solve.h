@@ -1,5 +1,27 @@
 #pragma once
 #include "forward.h"
+#include <vector>
+
+struct ParallelState;
+
+// Counters for where the solver spends its time. Each thread has its own set (see Get), so counting is just an increment.
+// Nothing resets them automatically: Callers take a copy before and after the work they want to measure, or call Reset.
+struct SolverStats {
+  u64 nodes = 0;               // Cells visited by SolveLoop, past the collision checks
+  u64 gapRejections = 0;       // Steps onto a gap
+  u64 prunes = 0;              // Paths abandoned before reaching an endpoint (by Validator::PushCell or an invalid region)
+  u64 endpointValidations = 0; // Full validations, once a path reaches an endpoint
+  u64 regionsComputed = 0;     // Regions found by a flood fill (on the grid, or on the bitmasks in Validator::RegionMasksValid)
+  u64 polyFits = 0;            // Calls to Polyominos::PolyFit
+  u64 placements = 0;          // Polyominos placed by Polyominos::TryPlacePolyshape
+
+  SolverStats& operator+=(const SolverStats& other);
+  static SolverStats& Get() { return _current; }
+  static void Reset() { _current = SolverStats(); }
+
+private:
+  static thread_local SolverStats _current;
+};
 
 class Solver {
 public:
@@ -7,19 +29,80 @@ public:
   ~Solver();
 
   // Generates a solution via DFS recursive backtracking
+  // For symmetry puzzles, the reflection of each path is checked at the same time, so only half of the start points are searched.
+  // In that case, if there are more than |maxSolutions| solutions, the ones returned may not be the first ones in DFS order.
   Vector<Path> Solve(Puzzle* puzzle_, int maxSolutions = 10'000);
+  // Same as Solve, but splits the DFS across |numThreads| threads (0 means one per core).
+  // Each task keeps only its own first |maxSolutions|. So the threads always use MoveOrder::Fixed, and never check the
+  // reflected coloring (which finds solutions out of order). That way, the result is always the first |maxSolutions|
+  // solutions in DFS order. This matches Solve, unless Solve stopped early with another move order, or on a symmetry puzzle.
+  // The workers' SolverStats are added to the calling thread's.
+  Vector<Path> SolveParallel(Puzzle* puzzle_, int maxSolutions = 10'000, int numThreads = 0);
+  // Same as Solve, but first builds a PathDiagram of the puzzle's paths (which joins partial paths from the start
+  // and from the end by their frontier state), then only validates the complete paths it contains.
+  // Much faster when the puzzle is mostly constrained by gaps, dots and symmetry, since the DFS can't see those dead ends
+  // until it reaches them. If there are more than |maxSolutions| solutions, this returns |maxSolutions| of them
+  // (sorted like Solve), but not necessarily the same ones as Solve.
+  Vector<Path> SolveBidirectional(Puzzle* puzzle_, int maxSolutions = 10'000);
+  void SetMoveOrder(MoveOrder order) { moveOrder = order; }
 
 private:
+  // Finds the start points and runs the pre-checks. Returns false if the puzzle is trivially unsolvable.
+  // If !|allowMirror|, symmetry puzzles search from every start point (see the comment in Prepare).
+  bool Prepare(Vector<Cell*>& startPoints, u8& numEndpoints, bool allowMirror = true);
+  // Flood fills the traversable lines from every start point, then repeatedly removes dead ends
+  // (cells which cannot be both entered and exited). Returns false if the puzzle is trivially unsolvable,
+  // i.e. we cannot reach an endpoint or cannot cover a dot. Marks the unusable cells in |deadCells|.
+  bool PrePass(const Vector<Cell*>& startPoints);
+  bool IsTraversable(Cell* cell);
+  // Sorts |solutions| into the order Solve would find them, and keeps the first MAX_SOLUTIONS.
+  Vector<Path> SortSolutions(std::vector<Path>& solutions);
+  // Draws (or erases, if !|draw|) |solution| onto the grid, and sets the puzzle's start and end points.
+  void TracePath(const Path& solution, bool draw);
+
+  // Helpers for symmetry puzzles, see the comment in Prepare.
+  bool HasSymmetricalEndpoints();
+  // Returns true if we should skip |startPoint|, since its reflection will find the same solutions.
+  bool IsMirroredStart(Cell* startPoint);
+  // Checks the current path with the colors swapped, and if valid, adds the reflected path to |solutionPaths|.
+  void AddMirrorSolution(Cell* endPoint, Vector<Path>& solutionPaths);
+  // Swaps the colors of the current path (which must end with PATH_NONE) and its reflection.
+  void SwapLineColors();
+  // Fills |distance| with the number of steps from each live cell to the nearest live endpoint.
+  void ComputeDistances(NArray<u8>* distance);
+
+  // Writes the directions which SolveLoop should try from (x, y) into |moves|, in order, and returns how many there are.
+  u8 OrderMoves(s8 x, s8 y, u8 moves[4]);
+  // Lower scores are tried first.
+  u16 MoveScore(Cell* cell);
+
   void TailRecurse(Cell* cell);
   // Note: Most mechanics are NP (or harder), so don't feel bad about solving them by brute force.
   // https://arxiv.org/pdf/1804.10193.pdf
   void SolveLoop(s8 x, s8 y, Vector<Path>& solutionPaths, u8 numEndpoints);
+  // Extends the path one step from (x, y) in direction |dir|, and continues solving from there.
+  void Recurse(s8 x, s8 y, u8 dir, Vector<Path>& solutionPaths, u8 numEndpoints);
 
   Puzzle* puzzle;
   Path* path;
   Validator* validator;
+  NArray<u8>* deadCells = nullptr;
+  u8 deadWidth = 0;
+  u8 deadHeight = 0;
+  MoveOrder moveOrder = (MoveOrder)0;
+  NArray<u8>* endDistance = nullptr; // Only computed when the move order needs it. Same size as |deadCells|.
+  std::vector<Cell*> dotCells;       // The live dots, for MoveOrder::Dots
+  // For move orders which only depend on the grid (not the path), OrderMoves is precomputed for each cell.
+  // The directions are packed into 4-bit nibbles, first move in the lowest nibble, terminated by PATH_NONE.
+  NArray<u16>* moveTable = nullptr;
   int MAX_SOLUTIONS = 0;
   bool doPruning = false;
+  bool mirrorSolutions = false;
+  // Only set while running inside SolveParallel: The path which this task must follow before branching,
+  // and the shared queues where we hand off subtrees to idle threads.
+  const Path* prefix = nullptr;
+  ParallelState* parallel = nullptr;
+  int workerIndex = 0;
   struct EarlyExitData {
     bool hasEverLeftEdge;
     s8 x1; s8 y1; bool isEdge1;
@@ -24,6 +24,18 @@ do { \
 #endif
 #endif // #ifndef assert
 
+// Build with COUNT_ALLOCATIONS=1 to count every heap allocation on each thread (for "bench", see Main.cpp).
+// This replaces the global operator new, which also hides the file and line from the CRT leak checker, so it's off by default.
+#ifndef COUNT_ALLOCATIONS
+#define COUNT_ALLOCATIONS 0
+#endif
+#if COUNT_ALLOCATIONS
+extern thread_local u64 numAllocations;
+#define COUNT_ALLOCATION() numAllocations++ // For the raw mallocs below, which operator new doesn't see.
+#else
+#define COUNT_ALLOCATION()
+#endif
+
 class LinearAllocator {
 public:
   LinearAllocator(u32 initialCapacity = 0x4000 - sizeof(Array) /* 4096 is the usual page size */) {
@@ -89,6 +101,7 @@ private:
   struct Array {
     [[nodiscard]]
     static Array* New(u32 capacity) {
+      COUNT_ALLOCATION();
       Array* b = (Array*)malloc(sizeof(Array) + capacity - 1);
       if (b == nullptr) return nullptr;
       b->size = 0;
@@ -137,6 +150,7 @@ public:
     _maxB = maxB;
     _maxC = maxC;
     _maxD = maxD;
+    COUNT_ALLOCATION();
     _data = (T*)malloc(sizeof(T) * maxA * maxB * maxC * maxD);
   }
   ~NArray() {
@@ -253,21 +267,26 @@ public:
   Vector& operator=(const Vector& other) = delete; // Copy assignment
 
   // Moving is OK, we need it for when we have a Vector<Vector<>>
+  // |other| is left empty (as if default-constructed), so it can still be used or assigned to afterwards.
   Vector(Vector&& other) noexcept { // Move constructor
     _size = other._size;
     _capacity = other._capacity;
-    // TODO: Are we leaking _data here?
     _data = other._data;
+    other._size = 0;
+    other._capacity = 0;
     other._data = nullptr;
   }
   Vector& operator=(Vector&& other) noexcept { // Move assignment
+    if (this == &other) return *this;
+    if (_data != nullptr) delete[] _data; // Our old contents are replaced, so free them (same as the destructor).
     _size = other._size;
     _capacity = other._capacity;
-    // TODO: Are we leaking _data here?
     _data = other._data;
+    other._size = 0;
+    other._capacity = 0;
     other._data = nullptr;
     return *this;
-   }
+  }
 
   // Functions for range-based iteration
   T* begin() {
@@ -0,0 +1,27 @@
+#include "stdafx.h"
+#include "Trace.h"
+#include <iomanip>
+
+using namespace std;
+
+thread_local Trace::Buffer Trace::_buffer;
+
+void Trace::Dump(ostream& os) {
+  static const char* eventNames[] = {"Seed", "SolveStart", "Solution", "SolveEnd", "Prepare"};
+
+  u32 first = _buffer.next > CAPACITY ? _buffer.next - CAPACITY : 0;
+  if (first == _buffer.next) return;
+  s64 startTime = _buffer.entries[first & (CAPACITY - 1)].time;
+  auto flags = os.flags();
+  if (first > 0) os << "(" << first << " earlier events were dropped)" << endl;
+  for (u32 i=first; i<_buffer.next; i++) {
+    const Entry& entry = _buffer.entries[i & (CAPACITY - 1)];
+    os << "+" << fixed << setprecision(3) << (entry.time - startTime) / 1'000'000.0 << "ms\t";
+    os << eventNames[(u8)entry.event] << "\t" << entry.a << "\t" << entry.b << endl;
+  }
+  os.flags(flags);
+}
+
+void Trace::Clear() {
+  _buffer.next = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "forward.h"
+#include <chrono>
+#include <iosfwd>
+
+// Things worth knowing about when a seed is slow. Each event carries up to two numbers (see Trace::Dump for their meaning).
+enum class TraceEvent : u8 {
+  Seed =       0, // a: seed
+  SolveStart = 1, // a: width, b: height
+  Solution =   2, // a: solutions so far, b: path length
+  SolveEnd =   3, // a: solutions
+  Prepare =    4, // a: start points, b: endpoints. Only logged if Prepare succeeds.
+};
+
+// A fixed-size ring buffer of the most recent events on this thread. Recording an event is just a few stores
+// (there is no locking, since each thread has its own buffer), so this stays on in release builds.
+// Nothing is formatted until Dump is called, e.g. after a slow seed.
+class Trace {
+public:
+  static void Record(TraceEvent event, u32 a = 0, u32 b = 0);
+  // Writes the events on this thread to |os|, oldest first.
+  static void Dump(std::ostream& os);
+  static void Clear();
+
+private:
+  static constexpr u32 CAPACITY = 1 << 10; // Must be a power of 2
+  struct Entry {
+    s64 time; // Nanoseconds, from steady_clock
+    u32 a;
+    u32 b;
+    TraceEvent event;
+  };
+  struct Buffer {
+    Entry entries[CAPACITY];
+    u32 next = 0; // Total number of events recorded. The next entry is entries[next % CAPACITY].
+  };
+  static thread_local Buffer _buffer;
+};
+
+inline void Trace::Record(TraceEvent event, u32 a, u32 b) {
+  Entry& entry = _buffer.entries[_buffer.next++ & (CAPACITY - 1)];
+  entry.time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  entry.a = a;
+  entry.b = b;
+  entry.event = event;
+}
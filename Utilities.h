@@ -43,6 +43,15 @@ enum class End : u8 {
 #define PATH_TOP    3
 #define PATH_BOTTOM 4
 
+// Which neighbor the solver tries first (see Solver::OrderMoves). This only changes which solutions are found first,
+// so it matters when we only want one solution (e.g. Random::IsSolvable).
+enum class MoveOrder : u8 {
+  Fixed =      0, // Left, right, up, down
+  NearestEnd = 1, // Towards the closest endpoint
+  Dots =       2, // Towards the closest dot which the path hasn't covered yet, then towards the closest endpoint
+  HugWalls =   3, // Into the cell with the fewest open neighbors, so that we don't seal off parts of the grid
+};
+
 enum class Type : u8 {
   Null =     0,
   Line =     1,
@@ -71,6 +80,16 @@ enum class Masked : u8 {
 };
 
 
+// Messages above this level (see Console::Level) are compiled out entirely, rather than checked at runtime.
+// Debug builds keep everything, so that the level can still be raised from the Autos tab.
+#ifndef CONSOLE_MAX_LEVEL
+#ifdef _DEBUG
+#define CONSOLE_MAX_LEVEL 5 // Spam
+#else
+#define CONSOLE_MAX_LEVEL 2 // Info
+#endif
+#endif
+
 class Console {
   enum Level {
     Error,
@@ -85,12 +104,12 @@ class Console {
   u8 _depth = 0;
 
 public:
-  template <typename... Types> void error  (const Types&... args) { _logGroup(Error, args...); }
-  template <typename... Types> void warning(const Types&... args) { _logGroup(Warning, args...); }
-  template <typename... Types> void info   (const Types&... args) { _logGroup(Info, args...); }
-  template <typename... Types> void log    (const Types&... args) { _logGroup(Log, args...); }
-  template <typename... Types> void debug  (const Types&... args) { _logGroup(Debug, args...); }
-  template <typename... Types> void spam   (const Types&... args) { _logGroup(Spam, args...); }
+  template <typename... Types> void error  (const Types&... args) { if constexpr (Error   <= CONSOLE_MAX_LEVEL) _logGroup(Error, args...); }
+  template <typename... Types> void warning(const Types&... args) { if constexpr (Warning <= CONSOLE_MAX_LEVEL) _logGroup(Warning, args...); }
+  template <typename... Types> void info   (const Types&... args) { if constexpr (Info    <= CONSOLE_MAX_LEVEL) _logGroup(Info, args...); }
+  template <typename... Types> void log    (const Types&... args) { if constexpr (Log     <= CONSOLE_MAX_LEVEL) _logGroup(Log, args...); }
+  template <typename... Types> void debug  (const Types&... args) { if constexpr (Debug   <= CONSOLE_MAX_LEVEL) _logGroup(Debug, args...); }
+  template <typename... Types> void spam   (const Types&... args) { if constexpr (Spam    <= CONSOLE_MAX_LEVEL) _logGroup(Spam, args...); }
 
   void group() { _depth += 2; }
   void groupEnd() { _depth -= 2; }
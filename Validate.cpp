@@ -5,6 +5,7 @@ Validator::Validator() {
   _stars = new Vector<Cell*>(4);
   _coloredObjects = new Vector<std::pair<int, u8>>();
   _regions = new Vector<Region>();
+  _scratchRegion = new Region(0);
 }
 
 Validator::~Validator() {
@@ -12,6 +13,8 @@ Validator::~Validator() {
   delete _squares;
   delete _stars;
   delete _coloredObjects;
+  delete _scratchRegion;
+  if (_triangleBorders) delete _triangleBorders;
   // delete _regions; // Leak the container because I can't figure out how to free it properly.
 }
 
@@ -39,7 +42,9 @@ RegionData Validator::Validate(Puzzle& puzzle, bool quick) {
           puzzle._hasPolyominos = true;
           break;
         case Type::Null:
+          break;
         case Type::Triangle:
+          monoRegionSize++; // Triangles don't need regions, but they do need to be checked.
           break;
         default:
           needsRegions = true;
@@ -75,6 +80,7 @@ RegionData Validator::Validate(Puzzle& puzzle, bool quick) {
       for (u8 y=0; y<puzzle._height; y++) {
         Cell* cell = &puzzle._grid->Get(x, y);
         if (cell->type == Type::Line && cell->line == Line::None) monoRegion.UnsafePush(cell);
+        else if (cell->type == Type::Triangle) monoRegion.UnsafePush(cell);
       }
     }
     _regions->Emplace(move(monoRegion));
@@ -94,6 +100,185 @@ RegionData Validator::Validate(Puzzle& puzzle, bool quick) {
   return puzzleData;
 }
 
+bool Validator::IsValid(Puzzle& puzzle) {
+  bool needsRegions = false;
+  int monoRegionSize = 0;
+  puzzle._hasNegations = false;
+  puzzle._hasPolyominos = false;
+
+  // Without negations, an uncovered dot or a wrong triangle is invalid no matter which region it's in.
+  // So, we check them here, and only use regions for squares and stars (see RegionMasksValid).
+  bool hasUncoveredDot = false;
+  bool hasWrongTriangle = false;
+  bool canUseMasks = puzzle._width <= 17 && puzzle._height <= 17; // One bit per cell, so up to 8x8 cells
+  _numMaskColors = 0;
+
+  // See Validate for an explanation of this loop.
+  for (u8 x=0; x<puzzle._width; x++) {
+    Cell* row = puzzle._grid->GetRow(x);
+    for (u8 y=0; y<puzzle._height; y++) {
+      Cell* cell = &row[y];
+      switch (cell->type) {
+        case Type::Nega:
+          puzzle._hasNegations = true;
+          break;
+        case Type::Poly:
+        case Type::Ylop:
+          puzzle._hasPolyominos = true;
+          break;
+        case Type::Null:
+          break;
+        case Type::Triangle:
+          monoRegionSize++;
+          if (!hasWrongTriangle) {
+            u8 count = 0;
+            if (puzzle.GetLine(x - 1, y) != Line::None) count++;
+            if (puzzle.GetLine(x + 1, y) != Line::None) count++;
+            if (puzzle.GetLine(x, y - 1) != Line::None) count++;
+            if (puzzle.GetLine(x, y + 1) != Line::None) count++;
+            if (cell->count != count) hasWrongTriangle = true;
+          }
+          break;
+        case Type::Square:
+        case Type::Star:
+          needsRegions = true;
+          if (canUseMasks) {
+            u8 colorId = GetMaskColorId(cell->color);
+            if (colorId == MAX_MASK_COLORS) {
+              canUseMasks = false;
+            } else {
+              u64 bit = 1ull << ((x / 2) * 8 + (y / 2));
+              if (cell->type == Type::Square) _squareMasks[colorId] |= bit;
+              else _starMasks[colorId] |= bit;
+            }
+          }
+          break;
+        default:
+          needsRegions = true;
+          break;
+        case Type::Line:
+          if (cell->line == Line::None) {
+            monoRegionSize++;
+            if (cell->dot != Dot::None) hasUncoveredDot = true;
+          } else {
+            if (cell->gap != Gap::None) return false;
+            if ((cell->dot == Dot::Blue && cell->line == Line::Yellow) ||
+                (cell->dot == Dot::Yellow && cell->line == Line::Blue)) return false;
+          }
+          break;
+      }
+    }
+  }
+
+  // Negations need the full list of invalid elements, and polyominos need the actual cells in each region,
+  // so those still go through the flood fill below.
+  if (canUseMasks && !puzzle._hasNegations && !puzzle._hasPolyominos) {
+    if (hasUncoveredDot || hasWrongTriangle) return false;
+    if (!needsRegions) return true;
+    return RegionMasksValid(puzzle);
+  }
+
+  Region& region = *_scratchRegion;
+  region.Ensure(puzzle._width * puzzle._height); // Enough for any region, so the flood fill never needs to grow it.
+  if (!needsRegions) {
+    region.Resize(0);
+    for (u8 x=0; x<puzzle._width; x++) {
+      Cell* row = puzzle._grid->GetRow(x);
+      for (u8 y=0; y<puzzle._height; y++) {
+        Cell* cell = &row[y];
+        if (cell->type == Type::Line && cell->line == Line::None) region.UnsafePush(cell);
+        else if (cell->type == Type::Triangle) region.UnsafePush(cell);
+      }
+    }
+    return IsRegionValid(puzzle, region);
+  }
+
+  // Same as Puzzle::GetRegions, except that we check each region before finding the next one.
+  puzzle.GenerateMaskedGrid();
+  for (u8 x=0; x<puzzle._width; x++) {
+    for (u8 y=0; y<puzzle._height; y++) {
+      if (puzzle._maskedGrid->Get(x, y) == Masked::Processed) continue;
+      region.Resize(0);
+      puzzle._floodFill(x, y, region);
+      SolverStats::Get().regionsComputed++;
+      if (!IsRegionValid(puzzle, region)) return false;
+    }
+  }
+  return true;
+}
+
+u8 Validator::GetMaskColorId(int color) {
+  for (u8 i=0; i<_numMaskColors; i++) {
+    if (_maskColors[i] == color) return i;
+  }
+  if (_numMaskColors == MAX_MASK_COLORS) return MAX_MASK_COLORS;
+  _maskColors[_numMaskColors] = color;
+  _squareMasks[_numMaskColors] = 0;
+  _starMasks[_numMaskColors] = 0;
+  return _numMaskColors++;
+}
+
+bool Validator::RegionMasksValid(const Puzzle& puzzle) {
+  // Each cell is one bit, at (x/2)*8 + (y/2). Two neighboring cells are in the same region unless the line between them
+  // is traced (a start or end point in the middle of a line doesn't count, see Puzzle::GenerateMaskedGrid).
+  // Regions can also connect through the untraced lines around the edge of the grid, but only via a vertex between
+  // two neighboring cells, which is traced whenever the line between them is.
+  u8 columns = puzzle._width / 2;
+  u8 rows = puzzle._height / 2;
+  bool wraps = puzzle._pillar;
+  u64 allCells = 0;
+  u64 openDown = 0;  // Cells which are connected to the cell below them
+  u64 openRight = 0; // Cells which are connected to the cell to their right (wrapping around for pillars)
+  auto isOpen = [&](s8 x, s8 y) {
+    Cell* line = puzzle.GetCell(x, y);
+    return line->line == Line::None || line == puzzle._startPoint || line == puzzle._endPoint;
+  };
+  for (u8 i=0; i<columns; i++) {
+    for (u8 j=0; j<rows; j++) {
+      u64 bit = 1ull << (i * 8 + j);
+      allCells |= bit;
+      if (j + 1 < rows && isOpen(2*i + 1, 2*j + 2)) openDown |= bit;
+      if ((i + 1 < columns || wraps) && isOpen(2*i + 2, 2*j + 1)) openRight |= bit;
+    }
+  }
+  u64 firstColumn = 0xFFull;
+  u8 lastShift = (columns - 1) * 8;
+  u64 lastColumn = firstColumn << lastShift;
+
+  u64 remaining = allCells;
+  while (remaining != 0) {
+    u64 region = remaining & (~remaining + 1); // Lowest set bit
+    while (true) {
+      u64 grown = region
+        | ((region & openDown) << 1) | ((region >> 1) & openDown)
+        | ((region & openRight) << 8) | ((region >> 8) & openRight);
+      if (wraps) {
+        grown |= ((region & openRight & lastColumn) >> lastShift) | (((region & firstColumn) << lastShift) & openRight);
+      }
+      grown &= allCells;
+      if (grown == region) break;
+      region = grown;
+    }
+    remaining &= ~region;
+    SolverStats::Get().regionsComputed++;
+
+    // See RegionCheck: Squares must all be the same color, and each star needs exactly one other object of its color.
+    u8 squareColors = 0;
+    for (u8 i=0; i<_numMaskColors; i++) {
+      if (region & _squareMasks[i]) squareColors++;
+      if ((region & _starMasks[i]) && __popcnt64(region & (_squareMasks[i] | _starMasks[i])) != 2) return false;
+    }
+    if (squareColors > 1) return false;
+  }
+  return true;
+}
+
+bool Validator::IsRegionValid(const Puzzle& puzzle, const Region& region) {
+  // Negations need the full list of invalid elements, so there's no shortcut.
+  if (puzzle._hasNegations) return ValidateRegion(puzzle, region, true).Valid();
+  return QuickRegionCheck(puzzle, region);
+}
+
 RegionData Validator::ValidateRegion(const Puzzle& puzzle, const Region& region, bool quick) {
   if (!puzzle._hasNegations) return RegionCheck(puzzle, region, quick);
 
@@ -136,7 +321,7 @@ RegionData Validator::ValidateRegion(const Puzzle& puzzle, const Region& region,
     target->type = Type::Null;
   }
 
-  regionData = RegionCheckNegations2(puzzle, region, negationSymbols, invalidElements);
+  regionData = RegionCheckNegations2(puzzle, region, negationSymbols, invalidElements, quick);
 
   // Restore required negations
   for (const auto& [source, target, sourceType, targetType] : baseCombination) {
@@ -153,16 +338,92 @@ RegionData Validator::RegionCheckNegations2(
   const Region& region,
   const Vector<Cell*>& negationSymbols,
   const Vector<Cell*>& invalidElements,
-  u8 index,
-  u8 index2) {
-  (void)puzzle;
-  (void)region;
-  (void)negationSymbols;
-  (void)invalidElements;
-  (void)index;
-  (void)index2;
-
-  return RegionData(0);
+  bool quick) {
+  // The negation symbols are interchangeable, so we only need to pick which invalid elements get negated.
+  // Each choice is a bitmask over invalidElements, and any leftover negation symbols must cancel each other in pairs.
+  u8 numNegations = (u8)negationSymbols.Size();
+  u8 numElements = (u8)min(invalidElements.Size(), 31);
+  u8 maxNegated = min(numNegations, numElements);
+
+  // Negating one of several identical elements (e.g. two red squares) gives the same region, so we only try subsets
+  // which take identical elements in order. |sameAs[i]| is the bit of the previous element identical to element i.
+  u32 sameAs[32] = {};
+  for (u8 i=0; i<numElements; i++) {
+    const Cell* a = invalidElements[i];
+    for (u8 j=0; j<i; j++) {
+      const Cell* b = invalidElements[j];
+      if (a->type == b->type && a->color == b->color && a->polyshape == b->polyshape && a->count == b->count) sameAs[i] = 1u << j;
+    }
+  }
+
+  Type types[32];
+  auto negate = [&](u32 subset) {
+    for (u8 i=0; i<numElements; i++) {
+      if (subset & (1u << i)) {
+        types[i] = invalidElements[i]->type;
+        invalidElements[i]->type = Type::Null;
+      }
+    }
+  };
+  auto restore = [&](u32 subset) {
+    for (u8 i=0; i<numElements; i++) {
+      if (subset & (1u << i)) invalidElements[i]->type = types[i];
+    }
+  };
+  // Records which negation symbol went where. The first few symbols each take one element from |subset|.
+  auto addNegations = [&](RegionData& regionData, u32 subset) {
+    u8 source = 0;
+    for (u8 i=0; i<numElements; i++) {
+      if (subset & (1u << i)) regionData.negations.Emplace({ negationSymbols[source++], invalidElements[i] });
+    }
+    for (; source + 1 < numNegations; source += 2) {
+      regionData.negations.Emplace({ negationSymbols[source], negationSymbols[source + 1] });
+    }
+    // A negation symbol with nothing left to negate is itself an error.
+    if (source < numNegations) regionData.invalidElements.Push(negationSymbols[source]);
+  };
+
+  // Try to negate as many elements as possible first, since that's the most likely way to solve the region.
+  for (s8 numNegated = maxNegated; numNegated >= 0; numNegated--) {
+    if ((numNegations - numNegated) % 2 != 0) continue;
+
+    // Gosper's hack: step through every |numNegated|-bit subset of the elements, in increasing order.
+    u32 subset = (1u << numNegated) - 1;
+    while (subset < (1u << numElements)) {
+      bool isCanonical = true;
+      for (u8 i=0; i<numElements; i++) {
+        if ((subset & (1u << i)) && sameAs[i] && !(subset & sameAs[i])) {
+          isCanonical = false;
+          break;
+        }
+      }
+
+      if (isCanonical) {
+        negate(subset);
+        bool valid = RegionCheck(puzzle, region, true).Valid();
+        restore(subset);
+        if (valid) {
+          console.debug("Negating", numNegated, "elements solves the region");
+          RegionData regionData(0);
+          addNegations(regionData, subset);
+          return regionData;
+        }
+      }
+
+      if (subset == 0) break;
+      u32 lowest = subset & (~subset + 1);
+      u32 ripple = subset + lowest;
+      subset = (((ripple ^ subset) >> 2) / lowest) | ripple;
+    }
+  }
+
+  // No combination worked. For display purposes, report the first attempt, which negates the most elements.
+  u32 subset = (1u << maxNegated) - 1;
+  negate(subset);
+  RegionData regionData = RegionCheck(puzzle, region, quick);
+  restore(subset);
+  addNegations(regionData, subset);
+  return regionData;
 }
 
 RegionData Validator::RegionCheck(const Puzzle& puzzle, const Region& region, bool quick) {
@@ -257,6 +518,193 @@ RegionData Validator::RegionCheck(const Puzzle& puzzle, const Region& region, bo
   return regionData;
 }
 
+bool Validator::StartPath(const Puzzle& puzzle, bool eitherColoring) {
+  _eitherColoring = eitherColoring;
+  _wrongColors[0] = 0;
+  _wrongColors[1] = 0;
+  // Negation symbols can cancel out any of the elements we check here, so we can only check the final path.
+  _incremental = !puzzle._hasNegations;
+  if (!_incremental) return true;
+
+  if (_triangleBorders == nullptr || _bordersWidth != puzzle._width || _bordersHeight != puzzle._height) {
+    if (_triangleBorders) delete _triangleBorders;
+    _bordersWidth = puzzle._width;
+    _bordersHeight = puzzle._height;
+    _triangleBorders = new NArray<u8>(_bordersWidth, _bordersHeight);
+  }
+  _triangleBorders->Fill((u8)0);
+
+  // Triangles with more required borders than traceable borders can never be satisfied (e.g. cut edges).
+  for (u8 x=1; x<puzzle._width; x+=2) {
+    for (u8 y=1; y<puzzle._height; y+=2) {
+      Cell* cell = &puzzle._grid->Get(x, y);
+      if (cell->type != Type::Triangle) continue;
+      Cell* borders[4] = {
+        puzzle.GetCell(x - 1, y),
+        puzzle.GetCell(x + 1, y),
+        puzzle.GetCell(x, y - 1),
+        puzzle.GetCell(x, y + 1),
+      };
+      u8 traceable = 0;
+      for (Cell* border : borders) {
+        if (border != nullptr && border->type == Type::Line && border->gap == Gap::None) traceable++;
+      }
+      if (traceable < cell->count) {
+        console.log("Triangle at", x, y, "only has", traceable, "traceable borders");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Validator::PushCell(Puzzle& puzzle, Cell* cell, Cell* previous) {
+  if (!_incremental) return true;
+
+  // Symmetry puzzles trace a blue and a yellow line, which may only cover dots of their own color (or black dots).
+  // Like the triangle borders, we always need to count these (even if we fail), since PopCell will remove them.
+  Cell* symCell = nullptr;
+  if (puzzle._symmetry != SYM_NONE) {
+    symCell = puzzle.GetSymmetricalCell(cell);
+    if (cell->dot == Dot::Yellow || symCell->dot == Dot::Blue) _wrongColors[0]++;
+    if (cell->dot == Dot::Blue || symCell->dot == Dot::Yellow) _wrongColors[1]++;
+  }
+
+  // Both lines count as triangle borders.
+  bool valid = AddTriangleBorders(puzzle, cell, +1);
+  if (symCell) valid &= AddTriangleBorders(puzzle, symCell, +1);
+  if (!valid) return false;
+  if (_wrongColors[0] > 0 && (!_eitherColoring || _wrongColors[1] > 0)) return false;
+
+  // Once the path moves on, the cells next to the previous cell can only be entered from their other neighbors.
+  // If one of those is a dot without enough open neighbors, we will never be able to cover it.
+  // This is much harder to reason about with two lines, so we only check non-symmetry puzzles.
+  if (previous != nullptr && symCell == nullptr) {
+    Cell* neighbors[4] = {
+      puzzle.GetCell(previous->x - 1, previous->y),
+      puzzle.GetCell(previous->x + 1, previous->y),
+      puzzle.GetCell(previous->x, previous->y - 1),
+      puzzle.GetCell(previous->x, previous->y + 1),
+    };
+    for (Cell* neighbor : neighbors) {
+      if (neighbor == nullptr || neighbor == cell) continue;
+      if (!IsDotReachable(puzzle, neighbor)) return false;
+    }
+  }
+
+  return true;
+}
+
+void Validator::PopCell(Puzzle& puzzle, Cell* cell) {
+  if (!_incremental) return;
+  AddTriangleBorders(puzzle, cell, -1);
+  if (puzzle._symmetry != SYM_NONE) {
+    Cell* symCell = puzzle.GetSymmetricalCell(cell);
+    AddTriangleBorders(puzzle, symCell, -1);
+    if (cell->dot == Dot::Yellow || symCell->dot == Dot::Blue) _wrongColors[0]--;
+    if (cell->dot == Dot::Blue || symCell->dot == Dot::Yellow) _wrongColors[1]--;
+  }
+}
+
+bool Validator::AddTriangleBorders(const Puzzle& puzzle, Cell* cell, s8 delta) {
+  // Only line segments (not intersections) are the border of a cell.
+  Cell* cells[2] = {nullptr, nullptr};
+  if (cell->x%2 == 1 && cell->y%2 == 0) {
+    cells[0] = puzzle.GetCell(cell->x, cell->y - 1);
+    cells[1] = puzzle.GetCell(cell->x, cell->y + 1);
+  } else if (cell->x%2 == 0 && cell->y%2 == 1) {
+    cells[0] = puzzle.GetCell(cell->x - 1, cell->y);
+    cells[1] = puzzle.GetCell(cell->x + 1, cell->y);
+  }
+
+  bool valid = true;
+  for (Cell* triangle : cells) {
+    if (triangle == nullptr || triangle->type != Type::Triangle) continue;
+    u8& borders = _triangleBorders->Get(triangle->x, triangle->y);
+    borders += delta;
+    if (borders > triangle->count) valid = false;
+  }
+  return valid;
+}
+
+bool Validator::IsDotReachable(const Puzzle& puzzle, Cell* cell) {
+  if (cell->dot == Dot::None || cell->line != Line::None) return true;
+
+  u8 openNeighbors = 0;
+  Cell* neighbors[4] = {
+    puzzle.GetCell(cell->x - 1, cell->y),
+    puzzle.GetCell(cell->x + 1, cell->y),
+    puzzle.GetCell(cell->x, cell->y - 1),
+    puzzle.GetCell(cell->x, cell->y + 1),
+  };
+  for (Cell* neighbor : neighbors) {
+    if (neighbor == nullptr || neighbor->type != Type::Line) continue;
+    if (neighbor->gap != Gap::None || neighbor->line != Line::None) continue;
+    openNeighbors++;
+  }
+
+  // We need to enter the dot and then leave it again -- unless we can stop on it.
+  return openNeighbors >= (cell->end != End::None ? 1 : 2);
+}
+
+bool Validator::QuickRegionCheck(const Puzzle& puzzle, const Region& region) {
+  // See RegionCheck for an explanation of these checks.
+  _stars->Resize(0);
+  _coloredObjects->Resize(0);
+  int squareColor = 0;
+
+  for (Cell* cell : region) {
+    switch (cell->type) {
+      case Type::Null:
+      default:
+        continue;
+
+      case Type::Line:
+        if (cell->dot != Dot::None) return false;
+        continue;
+
+      case Type::Triangle:
+        {
+          u8 count = 0;
+          if (puzzle.GetLine(cell->x - 1, cell->y) != Line::None) count++;
+          if (puzzle.GetLine(cell->x + 1, cell->y) != Line::None) count++;
+          if (puzzle.GetLine(cell->x, cell->y - 1) != Line::None) count++;
+          if (puzzle.GetLine(cell->x, cell->y + 1) != Line::None) count++;
+          if (cell->count != count) return false;
+        }
+        continue;
+
+      case Type::Square:
+        AddColoredObject(cell->color);
+        if (squareColor == 0) {
+          squareColor = cell->color;
+        } else if (squareColor != cell->color) {
+          return false;
+        }
+        continue;
+
+      case Type::Star:
+        _stars->Push(cell);
+        AddColoredObject(cell->color);
+        continue;
+    }
+  }
+
+  for (Cell* star : *_stars) {
+    if (GetColoredObject(star->color) != 2) return false;
+  }
+
+  if (puzzle._hasPolyominos) {
+    if (!Polyominos::PolyFit(region, puzzle)) {
+      for (Cell* cell : region) {
+        if (cell->type == Type::Poly || cell->type == Type::Ylop) return false;
+      }
+    }
+  }
+
+  return true;
+}
+
 u8 Validator::GetColoredObject(int color) {
   for (auto [color_, count] : *_coloredObjects) {
     if (color == color_) return count;
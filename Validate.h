@@ -19,16 +19,37 @@ public:
   // which attempts to apply any remaining negations to any other invalid elements.
   RegionData ValidateRegion(const Puzzle& puzzle, const Region& region, bool quick = false);
 
+  // Same as Validate(puzzle, true).Valid(), for the solver, which only needs a verdict.
+  // This does not build any RegionData, and (other than negations and polyominos) does not allocate:
+  // Each region is flood filled into a reused buffer, and checked as soon as it's found.
+  bool IsValid(Puzzle& puzzle);
+  // Same as ValidateRegion(puzzle, region, true).Valid().
+  bool IsRegionValid(const Puzzle& puzzle, const Region& region);
+
+  // Incremental checks, run by the solver while it extends the path. These only reject paths which cannot possibly
+  // become valid, so the full Validate() call is still required once we reach an endpoint.
+  // Resets the incremental state for a new puzzle. Returns false if the puzzle can never be valid.
+  // If |eitherColoring|, the solver will also try the path with the blue and yellow lines swapped (see Solver::Solve),
+  // so a dot of the wrong color only rejects the path once both colorings have covered one.
+  bool StartPath(const Puzzle& puzzle, bool eitherColoring = false);
+  // Called after |cell| (and its reflection, for symmetry puzzles) has been traced. |previous| is the cell we came from,
+  // or nullptr if |cell| is a start point. Returns false if the path can no longer become a solution.
+  // Regardless of the return value, PopCell must be called when the solver backtracks.
+  bool PushCell(Puzzle& puzzle, Cell* cell, Cell* previous);
+  void PopCell(Puzzle& puzzle, Cell* cell);
+  // Returns false if the current path (or, if |swapped|, the path with its colors swapped) covers a dot of the wrong color.
+  bool CouldBeValid(bool swapped) const { return _wrongColors[swapped ? 1 : 0] == 0; }
+
 private:
-  // Recursively matches negations and invalid elements from the grid. Note that this function
-  // doesn't actually modify the two lists, it just iterates through them with index/index2.
+  // Matches negations and invalid elements from the grid, by trying each subset of the invalid elements (as a bitmask).
+  // Each negation symbol must cancel either one invalid element or another negation symbol.
+  // Note that this function temporarily modifies the cells in the two lists, but restores them before returning.
   RegionData RegionCheckNegations2(
     const Puzzle& puzzle,
     const Region& region,
     const Vector<Cell*>& negationSymbols,
     const Vector<Cell*>& invalidElements,
-    u8 index = 0,
-    u8 index2 = 0);
+    bool quick);
 
   // Checks if a region is valid. This does not handle negations -- we assume that there are none.
   // Note that this function needs to always ask the puzzle for the current contents of the cell,
@@ -36,11 +57,39 @@ private:
   // @Performance: This is a pretty core function to the solve loop.
   RegionData RegionCheck(const Puzzle& puzzle, const Region& region, bool quick = false);
 
+  // The quick version of RegionCheck, which returns as soon as it finds an invalid element.
+  bool QuickRegionCheck(const Puzzle& puzzle, const Region& region);
+  // Used by IsValid when there are no negations or polyominos: Finds each region as a bitmask of cells,
+  // and checks the squares and stars in it against the per-color bitmasks.
+  bool RegionMasksValid(const Puzzle& puzzle);
+  // Returns the index of |color| in _maskColors (adding it if needed), or MAX_MASK_COLORS if there are too many colors.
+  u8 GetMaskColorId(int color);
+
   u8 GetColoredObject(int color);
   void AddColoredObject(int color);
 
+  // Adds |delta| to the border count of every triangle next to |cell|. Returns false if any triangle has too many borders.
+  bool AddTriangleBorders(const Puzzle& puzzle, Cell* cell, s8 delta);
+  // Returns false if |cell| has an uncovered dot which can no longer be covered, i.e. it has too few open neighbors.
+  bool IsDotReachable(const Puzzle& puzzle, Cell* cell);
+
   Vector<Cell*>* _squares;
   Vector<Cell*>* _stars;
   Vector<std::pair<int, u8>>* _coloredObjects;
   Vector<Region>* _regions;
+  Region* _scratchRegion; // Used by IsValid
+
+  // Also used by IsValid: The squares and stars of each color, one bit per cell (see RegionMasksValid).
+  static constexpr u8 MAX_MASK_COLORS = 8;
+  u8 _numMaskColors = 0;
+  int _maskColors[MAX_MASK_COLORS];
+  u64 _squareMasks[MAX_MASK_COLORS];
+  u64 _starMasks[MAX_MASK_COLORS];
+
+  bool _incremental = false;
+  bool _eitherColoring = false;
+  u16 _wrongColors[2] = {0, 0}; // Number of dots covered by the wrong color of line, as drawn and with the colors swapped
+  NArray<u8>* _triangleBorders = nullptr;
+  u8 _bordersWidth = 0;
+  u8 _bordersHeight = 0;
 };
\ No newline at end of file
@@ -17,6 +17,7 @@ enum class Gap    : u8;
 enum class End    : u8;
 enum class Type   : u8;
 enum class Masked : u8;
+enum class MoveOrder : u8;
 struct Cell;
 class Puzzle;
 class Random;
@@ -17,6 +17,7 @@
 #define assert(cond) {}
 #endif
 
+#include "PathDiagram.h"
 #include "Polyominos.h"
 #include "Puzzle.h"
 #include "Random.h"